@@ -0,0 +1,376 @@
+#include "XBench.h"
+#include "XCpu.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cmath>
+#include <openssl/rand.h>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define XBENCH_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define XBENCH_RDTSC
+#endif
+using namespace std;
+
+//СһβٴֽʱȺ߳ͬӰ
+#define XBENCH_SAMPLE_BYTES (1024 * 1024)
+
+//ﵽʱٱĲ
+#define XBENCH_MIN_SAMPLES 3
+
+//ivС˼һӵһֽڿʼλAEADֻǰ12ֽ
+static void NextIV(unsigned char* iv, int size)
+{
+	for (int i = 0; i < size && ++iv[i] == 0; i++);
+}
+
+static const char* type_names[] = {
+	"XDES_ECB",
+	"XDES_CBC",
+	"X3DES_ECB",
+	"X3DES_CBC",
+	"XAES128_ECB",
+	"XAES128_CBC",
+	"XAES192_ECB",
+	"XAES192_CBC",
+	"XAES256_ECB",
+	"XAES256_CBC",
+	"XSM4_ECB",
+	"XSM4_CBC",
+	"XAES128_CTR",
+	"XAES192_CTR",
+	"XAES256_CTR",
+	"XSM4_CTR",
+	"XAES128_GCM",
+	"XAES192_GCM",
+	"XAES256_GCM",
+	"XSM4_GCM",
+	"XCHACHA20_POLY1305"
+};
+
+//ʱ
+static unsigned long long Cycles()
+{
+#ifdef XBENCH_RDTSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+//ݵİٷλȷ
+static double Percentile(const vector<double>& sorted, double p)
+{
+	if (sorted.empty()) return 0;
+	int i = (int)ceil(p * sorted.size()) - 1;
+	if (i < 0) i = 0;
+	if (i >= (int)sorted.size()) i = (int)sorted.size() - 1;
+	return sorted[i];
+}
+
+//㷨ƣ"XAES128_GCM"
+const char* XBench::TypeName(XSecType type)
+{
+	if (type < 0 || type >= (int)(sizeof(type_names) / sizeof(type_names[0])))
+		return "";
+	return type_names[type];
+}
+
+/////////////////////////////////////////////////////////////////
+/// ò
+void XBench::Init(const XBenchConfig& conf)
+{
+	conf_ = conf;
+	if (conf_.types.empty())
+	{
+		for (int i = XDES_ECB; i <= XCHACHA20_POLY1305; i++)
+			conf_.types.push_back((XSecType)i);
+	}
+	if (conf_.warmup < 0) conf_.warmup = 0;
+	if (conf_.repeat < 1) conf_.repeat = 1;
+}
+
+/////////////////////////////////////////////////////////////////
+/// һ
+/// ÿ߳һXSecÿμӽǰResetصʼivģͬʱ
+/// һ߳ڵִ߳Уǽʱ֪ͨʼ߳
+bool XBench::RunCase(XSecType type, int size, int threads, bool is_en, XBenchResult& re)
+{
+	if (size <= 0 || threads <= 0)
+		return false;
+
+	//ù̶α
+	if ((int)data_.size() < size)
+	{
+		size_t old = data_.size();
+		data_.resize(size);
+		unsigned int seed = 1 + (unsigned int)old;
+		for (size_t i = old; i < data_.size(); i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			data_[i] = (unsigned char)(seed >> 16);
+		}
+	}
+
+	struct Worker
+	{
+		XSec sec;
+		vector<unsigned char> src;	//ʱ
+		vector<unsigned char> out;
+		const unsigned char* in = nullptr;
+		int in_size = 0;
+		unsigned char tag[XSEC_TAG_SIZE] = { 0 };
+		bool has_tag = false;
+		bool ok = true;
+
+		//CTRAEADģʽnonceÿβǰ
+		unsigned char iv[16] = { 0 };
+	};
+	string pass = "12345678ABCDEFGHabcdefgh!@#$%^&*";
+	vector<unique_ptr<Worker> > workers;
+	for (int i = 0; i < threads; i++)
+	{
+		unique_ptr<Worker> w(new Worker);
+		RAND_bytes(w->iv, sizeof(w->iv));
+		if (!w->sec.Init(type, pass, true, w->iv))
+			return false;
+		w->out.resize(size + 64);
+		w->in = data_.data();
+		w->in_size = size;
+		if (!is_en)
+		{
+			w->src.resize(size + 64);
+			int n = w->sec.Encrypt(data_.data(), size, w->src.data());
+			if (n <= 0)
+				return false;
+			w->has_tag = w->sec.GetTag(w->tag);
+			if (!w->sec.Init(type, pass, false, w->iv))
+				return false;
+			w->in = w->src.data();
+			w->in_size = n;
+		}
+		workers.push_back(move(w));
+	}
+
+	int ops = XBENCH_SAMPLE_BYTES / size;
+	if (ops < 1) ops = 1;
+	auto op = [ops, is_en](Worker& w) {
+		for (int i = 0; i < ops && w.ok; i++)
+		{
+			//Ҫʱnonce
+			if (is_en)
+				NextIV(w.iv, sizeof(w.iv));
+			w.sec.Reset(w.iv);
+			if (!is_en && w.has_tag)
+				w.sec.SetTag(w.tag);
+			if (w.sec.Encrypt(w.in, w.in_size, w.out.data()) <= 0)
+				w.ok = false;
+		}
+	};
+
+	//gen_ÿһ֪ͨ߳һβdone_ͳɵ߳
+	mutex mux;
+	condition_variable start_cv;
+	condition_variable done_cv;
+	int gen = 0;
+	int done = 0;
+	bool is_exit = false;
+	vector<thread> ths;
+	for (int i = 1; i < threads; i++)
+	{
+		Worker* w = workers[i].get();
+		ths.push_back(thread([&, w] {
+			int seen = 0;
+			for (;;)
+			{
+				{
+					unique_lock<mutex> lock(mux);
+					start_cv.wait(lock, [&] { return gen != seen; });
+					seen = gen;
+					if (is_exit) return;
+				}
+				op(*w);
+				{
+					unique_lock<mutex> lock(mux);
+					done++;
+				}
+				done_cv.notify_one();
+			}
+		}));
+	}
+
+	vector<double> times;
+	vector<double> cycles;
+	auto case_start = chrono::steady_clock::now();
+	for (int s = 0; s < conf_.warmup + conf_.repeat; s++)
+	{
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - case_start).count();
+		if ((int)times.size() >= XBENCH_MIN_SAMPLES && elapsed > conf_.max_case_time)
+			break;
+
+		auto t0 = chrono::steady_clock::now();
+		unsigned long long c0 = Cycles();
+		{
+			unique_lock<mutex> lock(mux);
+			done = 0;
+			gen++;
+		}
+		start_cv.notify_all();
+		op(*workers[0]);
+		{
+			unique_lock<mutex> lock(mux);
+			done_cv.wait(lock, [&] { return done == threads - 1; });
+		}
+		unsigned long long c1 = Cycles();
+		auto t1 = chrono::steady_clock::now();
+		if (s >= conf_.warmup)
+		{
+			times.push_back(chrono::duration<double>(t1 - t0).count());
+			cycles.push_back((double)(c1 - c0));
+		}
+	}
+	{
+		unique_lock<mutex> lock(mux);
+		is_exit = true;
+		gen++;
+	}
+	start_cv.notify_all();
+	for (auto& th : ths)
+		th.join();
+
+	for (auto& w : workers)
+	{
+		if (!w->ok) return false;
+	}
+	if (times.empty())
+		return false;
+
+	sort(times.begin(), times.end());
+	sort(cycles.begin(), cycles.end());
+	double bytes = (double)size * ops * threads;
+	double median = Percentile(times, 0.5);
+	re.type = type;
+	re.type_name = TypeName(type);
+	re.impl = XCpu::ImplName(type);
+	re.is_en = is_en;
+	re.size = size;
+	re.threads = threads;
+	re.ops = ops;
+	re.samples = (int)times.size();
+	re.mbps = median > 0 ? bytes / median / 1e6 : 0;
+	re.mbps_best = times[0] > 0 ? bytes / times[0] / 1e6 : 0;
+
+	//ÿ̴߳ops*sizeֽڣ̲߳ʱǽÿ˵
+	re.cycles_per_byte = Percentile(cycles, 0.5) / ((double)size * ops);
+
+	//һβڵμӽܵƽʱڲ֮ȡٷλ
+	re.mean_p50_us = median / ops * 1e6;
+	re.mean_p90_us = Percentile(times, 0.9) / ops * 1e6;
+	re.mean_p99_us = Percentile(times, 0.99) / ops * 1e6;
+	re.mean_max_us = times.back() / ops * 1e6;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// 㷨  ݴС  ߳  ӽ
+std::vector<XBenchResult> XBench::Run(std::ostream* log)
+{
+	vector<XBenchResult> results;
+	for (auto type : conf_.types)
+	{
+		//ֵ֧㷨
+		XSec sec;
+		if (!sec.Init(type, "12345678", true))
+		{
+			if (log) *log << TypeName(type) << " not supported, skip" << endl;
+			continue;
+		}
+		sec.close();
+
+		for (auto size : conf_.sizes)
+		{
+			for (auto threads : conf_.threads)
+			{
+				for (int d = 0; d < 2; d++)
+				{
+					bool is_en = d == 0;
+					if (!is_en && !conf_.decrypt)
+						continue;
+
+					// + ÿ̵߳ʱÿ̻߳һ
+					long long mem = (long long)size + (long long)(size + 64) * threads * (is_en ? 1 : 2);
+					if (mem > conf_.max_memory)
+					{
+						if (log) *log << TypeName(type) << " size=" << size << " threads=" << threads
+							<< " needs " << mem / (1024 * 1024) << "MB, skip" << endl;
+						continue;
+					}
+
+					XBenchResult re;
+					if (!RunCase(type, size, threads, is_en, re))
+					{
+						if (log) *log << TypeName(type) << " size=" << size << " failed" << endl;
+						continue;
+					}
+					if (log)
+					{
+						*log << re.type_name << "\t" << (is_en ? "en" : "de") << "\t" << size
+							<< "\tthreads=" << threads << "\t" << fixed << setprecision(1) << re.mbps << " MB/s"
+							<< "\t" << setprecision(2) << re.cycles_per_byte << " cpb"
+							<< "\tmean p50=" << re.mean_p50_us << "us max=" << re.mean_max_us << "us" << endl;
+						log->unsetf(ios::fixed);
+					}
+					results.push_back(re);
+				}
+			}
+		}
+	}
+	return results;
+}
+
+//תCSVһΪ
+std::string XBench::ToCSV(const std::vector<XBenchResult>& results)
+{
+	stringstream ss;
+	ss << "type,impl,direction,size,threads,ops,samples,mb_s,mb_s_best,cycles_per_byte,mean_p50_us,mean_p90_us,mean_p99_us,mean_max_us\n";
+	ss << fixed << setprecision(3);
+	for (auto& re : results)
+	{
+		ss << re.type_name << ",\"" << re.impl << "\"," << (re.is_en ? "encrypt" : "decrypt") << ","
+			<< re.size << "," << re.threads << "," << re.ops << "," << re.samples << ","
+			<< re.mbps << "," << re.mbps_best << "," << re.cycles_per_byte << ","
+			<< re.mean_p50_us << "," << re.mean_p90_us << "," << re.mean_p99_us << "," << re.mean_max_us << "\n";
+	}
+	return ss.str();
+}
+
+//תJSON
+std::string XBench::ToJSON(const std::vector<XBenchResult>& results)
+{
+	stringstream ss;
+	ss << fixed << setprecision(3);
+	ss << "[\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		auto& re = results[i];
+		ss << "  {\"type\":\"" << re.type_name << "\",\"impl\":\"" << re.impl << "\""
+			<< ",\"direction\":\"" << (re.is_en ? "encrypt" : "decrypt") << "\""
+			<< ",\"size\":" << re.size << ",\"threads\":" << re.threads
+			<< ",\"ops\":" << re.ops << ",\"samples\":" << re.samples
+			<< ",\"mb_s\":" << re.mbps << ",\"mb_s_best\":" << re.mbps_best
+			<< ",\"cycles_per_byte\":" << re.cycles_per_byte
+			<< ",\"mean_p50_us\":" << re.mean_p50_us << ",\"mean_p90_us\":" << re.mean_p90_us
+			<< ",\"mean_p99_us\":" << re.mean_p99_us << ",\"mean_max_us\":" << re.mean_max_us << "}"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	ss << "]\n";
+	return ss.str();
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include "XSec.h"
+
+//ܲ
+struct XBenchConfig
+{
+	//Ե㷨ձʾȫ
+	std::vector<XSecType> types;
+
+	//ݴСÿμӽֽܵ
+	std::vector<int> sizes = {
+		64, 256, 1024, 4 * 1024, 16 * 1024, 64 * 1024,
+		1024 * 1024, 16 * 1024 * 1024, 256 * 1024 * 1024, 1024 * 1024 * 1024
+	};
+
+	//߳ÿ߳ʹԼXSecӽ
+	std::vector<int> threads = { 1, 2, 4, 8 };
+
+	//Ԥȴ
+	int warmup = 2;
+
+	//ʱ
+	int repeat = 10;
+
+	//ʱ䣨룩ٲ3ΣDES㷨ܴݹ
+	double max_case_time = 10;
+
+	//ڴ棬
+	long long max_memory = 3LL * 1024 * 1024 * 1024;
+
+	//ǷԽ
+	bool decrypt = true;
+};
+
+//һĲԽ
+struct XBenchResult
+{
+	XSecType type = XDES_ECB;
+	std::string type_name;
+
+	//OpenSSLѡʵ
+	std::string impl;
+
+	bool is_en = true;
+	int size = 0;
+	int threads = 0;
+
+	//ÿβÿ̼߳ӽܵĴСһβӽܶ
+	int ops = 0;
+
+	//
+	int samples = 0;
+
+	//̺߳ϼλֵMB/s
+	double mbps = 0;
+	double mbps_best = 0;
+
+	//ÿֽCPUʱx86Ϊ0
+	double cycles_per_byte = 0;
+
+	//ÿβƽʱʱ/opsڸİٷλ΢
+	//ֻsamplesֵǵμӽܵʱֲʱp90 p99ӽֵ
+	double mean_p50_us = 0;
+	double mean_p90_us = 0;
+	double mean_p99_us = 0;
+	double mean_max_us = 0;
+};
+
+/*
+XBenchConfig conf;
+conf.sizes = { 64, 4096, 1024 * 1024 };
+XBench bench;
+bench.Init(conf);
+auto re = bench.Run();
+cout << XBench::ToCSV(re);
+*/
+class XBench
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// ò
+	void Init(const XBenchConfig& conf);
+
+	/////////////////////////////////////////////////////////////////
+	/// 㷨  ݴС  ߳  ӽ
+	/// @para log ÿһӡһУNULLӡ
+	/// @return Խֵ֧㷨ڴ泬ڽ
+	std::vector<XBenchResult> Run(std::ostream* log = nullptr);
+
+	/////////////////////////////////////////////////////////////////
+	/// һ
+	/// @return ɹtrue㷨ֻ֧ӽʧܷfalse
+	bool RunCase(XSecType type, int size, int threads, bool is_en, XBenchResult& re);
+
+	//תCSVһΪ
+	static std::string ToCSV(const std::vector<XBenchResult>& results);
+
+	//תJSON
+	static std::string ToJSON(const std::vector<XBenchResult>& results);
+
+	//㷨ƣ"XAES128_GCM"
+	static const char* TypeName(XSecType type);
+
+private:
+	XBenchConfig conf_;
+
+	//õݣݴС
+	std::vector<unsigned char> data_;
+};
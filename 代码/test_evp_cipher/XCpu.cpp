@@ -0,0 +1,340 @@
+#include "XCpu.h"
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define XCPU_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+using namespace std;
+
+//OpenSSLOPENSSL_ia32cap
+#define XCPU_ENV "OPENSSL_ia32cap"
+
+//OPENSSL_ia32capһ64λ32λcpuid(1).EDX32λcpuid(1).ECX
+#define CAP0_PCLMUL (1ULL << 33)
+#define CAP0_SSSE3 (1ULL << 41)
+#define CAP0_MOVBE (1ULL << 54)
+#define CAP0_AESNI (1ULL << 57)
+#define CAP0_OSXSAVE (1ULL << 59)
+#define CAP0_AVX (1ULL << 60)
+
+//OPENSSL_ia32capڶ64λ32λcpuid(7).EBX32λcpuid(7).ECX
+#define CAP1_AVX2 (1ULL << 5)
+#define CAP1_AVX512F (1ULL << 16)
+#define CAP1_AVX512DQ (1ULL << 17)
+#define CAP1_AVX512IFMA (1ULL << 21)
+#define CAP1_SHA (1ULL << 29)
+#define CAP1_AVX512BW (1ULL << 30)
+#define CAP1_AVX512VL (1ULL << 31)
+#define CAP1_VAES (1ULL << 41)
+#define CAP1_VPCLMUL (1ULL << 42)
+
+#define CAP1_AVX512 (CAP1_AVX512F | CAP1_AVX512DQ | CAP1_AVX512IFMA \
+	| CAP1_AVX512BW | CAP1_AVX512VL | CAP1_VAES | CAP1_VPCLMUL)
+
+//ÿʵҪε
+static const uint64_t impl_mask[XIMPL_COUNT][2] = {
+	{ 0, 0 },
+	{ 0, CAP1_AVX512 },
+	{ CAP0_AVX, CAP1_AVX512 | CAP1_AVX2 },
+	{ CAP0_AESNI | CAP0_PCLMUL, CAP1_VAES | CAP1_VPCLMUL },
+	{ CAP0_AESNI | CAP0_PCLMUL | CAP0_SSSE3 | CAP0_MOVBE | CAP0_AVX,
+		CAP1_AVX512 | CAP1_AVX2 | CAP1_SHA },
+};
+
+static const char* impl_names[XIMPL_COUNT] = {
+	"auto",
+	"no-avx512",
+	"no-avx",
+	"no-aesni",
+	"generic"
+};
+
+//ȡcpuidʽOpenSSLOPENSSL_ia32cap_Pͬ
+static void ReadCap(uint64_t cap[2])
+{
+	cap[0] = cap[1] = 0;
+#ifdef XCPU_X86
+	unsigned int r[4] = { 0 };	//eax ebx ecx edx
+#ifdef _MSC_VER
+	__cpuidex((int*)r, 0, 0);
+#else
+	__cpuid_count(0, 0, r[0], r[1], r[2], r[3]);
+#endif
+	unsigned int max_leaf = r[0];
+#ifdef _MSC_VER
+	__cpuidex((int*)r, 1, 0);
+#else
+	__cpuid_count(1, 0, r[0], r[1], r[2], r[3]);
+#endif
+	cap[0] = ((uint64_t)r[2] << 32) | r[3];
+	if (max_leaf >= 7)
+	{
+#ifdef _MSC_VER
+		__cpuidex((int*)r, 7, 0);
+#else
+		__cpuid_count(7, 0, r[0], r[1], r[2], r[3]);
+#endif
+		cap[1] = ((uint64_t)r[2] << 32) | r[1];
+	}
+
+	//ϵͳûбYMM ZMMĴʹAVXOpenSSLҲ
+	uint64_t xcr0 = 0;
+	if (cap[0] & CAP0_OSXSAVE)
+	{
+#ifdef _MSC_VER
+		xcr0 = _xgetbv(0);
+#else
+		unsigned int lo = 0, hi = 0;
+		__asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		xcr0 = ((uint64_t)hi << 32) | lo;
+#endif
+	}
+	if ((xcr0 & 6) != 6)
+	{
+		cap[0] &= ~CAP0_AVX;
+		cap[1] &= ~(CAP1_AVX2 | CAP1_AVX512);
+	}
+	if ((xcr0 & 0xe6) != 0xe6)
+		cap[1] &= ~CAP1_AVX512;
+#endif
+}
+
+static XCpuInfo Decode(const uint64_t cap[2])
+{
+	XCpuInfo info;
+	info.ssse3 = (cap[0] & CAP0_SSSE3) != 0;
+	info.pclmul = (cap[0] & CAP0_PCLMUL) != 0;
+	info.movbe = (cap[0] & CAP0_MOVBE) != 0;
+	info.aesni = (cap[0] & CAP0_AESNI) != 0;
+	info.avx = (cap[0] & CAP0_AVX) != 0;
+	info.avx2 = (cap[1] & CAP1_AVX2) != 0;
+	info.avx512f = (cap[1] & CAP1_AVX512F) != 0;
+	info.avx512bw = (cap[1] & CAP1_AVX512BW) != 0;
+	info.avx512vl = (cap[1] & CAP1_AVX512VL) != 0;
+	info.avx512ifma = (cap[1] & CAP1_AVX512IFMA) != 0;
+	info.sha = (cap[1] & CAP1_SHA) != 0;
+	info.vaes = (cap[1] & CAP1_VAES) != 0;
+	info.vpclmul = (cap[1] & CAP1_VPCLMUL) != 0;
+	return info;
+}
+
+//OPENSSL_ia32capֵ
+static string ImplEnv(XCpuImpl impl)
+{
+	char buf[64] = { 0 };
+	snprintf(buf, sizeof(buf), "~0x%llx:~0x%llx",
+		(unsigned long long)impl_mask[impl][0], (unsigned long long)impl_mask[impl][1]);
+	return buf;
+}
+
+/////////////////////////////////////////////////////////////////
+/// CPUӲֵ֧ԣcpuidͲϵͳǷ񱣴AVXĴ
+XCpuInfo XCpu::Hardware()
+{
+	uint64_t cap[2];
+	ReadCap(cap);
+	return Decode(cap);
+}
+
+/////////////////////////////////////////////////////////////////
+/// OpenSSLʵʹõԣӲ԰OPENSSL_ia32capκĽ
+/// OpenSSLͬ"~"ӦλֱӸֵ滻":"ǵڶ64λ
+XCpuInfo XCpu::Active()
+{
+	uint64_t cap[2];
+	ReadCap(cap);
+	const char* env = getenv(XCPU_ENV);
+	if (env && *env)
+	{
+		if (env[0] != ':')
+		{
+			bool off = env[0] == '~';
+			uint64_t v = strtoull(env + off, nullptr, 0);
+			cap[0] = off ? (cap[0] & ~v) : v;
+		}
+		const char* p = strchr(env, ':');
+		if (p)
+		{
+			bool off = p[1] == '~';
+			uint64_t v = strtoull(p + 1 + off, nullptr, 0);
+			cap[1] = off ? (cap[1] & ~v) : v;
+		}
+	}
+	return Decode(cap);
+}
+
+/////////////////////////////////////////////////////////////////
+/// 㷨ڵǰCPUOpenSSLѡʵ
+/// ӦOpenSSL 3.x x86_64ѡ߼ƽ̨"C"
+std::string XCpu::ImplName(XSecType type)
+{
+#ifndef XCPU_X86
+	return "C";
+#else
+	XCpuInfo cpu = Active();
+	switch (type)
+	{
+	//DESûSIMDʵ
+	case XDES_ECB:
+	case XDES_CBC:
+	case X3DES_ECB:
+	case X3DES_CBC:
+		return "C";
+
+	//x86SM4ֻCʵ
+	case XSM4_ECB:
+	case XSM4_CBC:
+	case XSM4_CTR:
+		return "C";
+	case XSM4_GCM:
+	{
+		EVP_CIPHER* c = EVP_CIPHER_fetch(NULL, "SM4-GCM", NULL);
+		if (!c) return "unsupported";
+		EVP_CIPHER_free(c);
+		return cpu.pclmul ? "C+PCLMUL" : "C";
+	}
+
+	case XAES128_GCM:
+	case XAES192_GCM:
+	case XAES256_GCM:
+#if OPENSSL_VERSION_NUMBER >= 0x30100000L
+		if (cpu.aesni && cpu.vaes && cpu.vpclmul && cpu.avx512f && cpu.avx512bw && cpu.avx512vl)
+			return "VAES+VPCLMUL(AVX-512)";
+#endif
+		if (cpu.aesni && cpu.pclmul && cpu.avx && cpu.movbe)
+			return "AES-NI+PCLMUL(AVX stitched)";
+		if (cpu.aesni && cpu.pclmul)
+			return "AES-NI+PCLMUL";
+		if (cpu.aesni)
+			return "AES-NI+GHASH(C)";
+		if (cpu.ssse3)
+			return cpu.pclmul ? "vpaes(SSSE3)+PCLMUL" : "vpaes(SSSE3)+GHASH(C)";
+		return "C";
+
+	case XCHACHA20_POLY1305:
+	{
+		string chacha = "x86_64";
+		if (cpu.avx512vl) chacha = "AVX-512VL";
+		else if (cpu.avx512f) chacha = "AVX-512";
+		else if (cpu.avx2) chacha = "AVX2";
+		else if (cpu.ssse3) chacha = "SSSE3";
+		string poly = "x86_64";
+		if (cpu.avx512ifma) poly = "AVX-512IFMA";
+		else if (cpu.avx512f) poly = "AVX-512";
+		else if (cpu.avx2) poly = "AVX2";
+		else if (cpu.avx) poly = "AVX";
+		return "ChaCha20 " + chacha + " + Poly1305 " + poly;
+	}
+
+	//AES ECB CBC CTR
+	default:
+		if (cpu.aesni) return "AES-NI";
+		if (cpu.ssse3) return "vpaes(SSSE3)";
+		return "C";
+	}
+#endif
+}
+
+/////////////////////////////////////////////////////////////////
+/// ǿOpenSSLʹָʵ֣ûOPENSSL_ia32cap
+bool XCpu::SetImpl(XCpuImpl impl)
+{
+#ifndef XCPU_X86
+	return false;
+#else
+	if (impl < 0 || impl >= XIMPL_COUNT)
+		return false;
+	string val;
+	if (impl != XIMPL_AUTO)
+		val = ImplEnv(impl);
+#ifdef _WIN32
+	//ֵΪʱɾ
+	return _putenv_s(XCPU_ENV, val.c_str()) == 0;
+#else
+	if (val.empty())
+		return unsetenv(XCPU_ENV) == 0;
+	return setenv(XCPU_ENV, val.c_str(), 1) == 0;
+#endif
+#endif
+}
+
+/////////////////////////////////////////////////////////////////
+/// ǰ̵OPENSSL_ia32capӦʵ
+XCpuImpl XCpu::CurrentImpl()
+{
+	const char* env = getenv(XCPU_ENV);
+	if (!env || !*env)
+		return XIMPL_AUTO;
+	for (int i = XIMPL_AUTO + 1; i < XIMPL_COUNT; i++)
+	{
+		if (ImplEnv((XCpuImpl)i) == env)
+			return (XCpuImpl)i;
+	}
+	return XIMPL_AUTO;
+}
+
+//ʵֵ
+const char* XCpu::ImplName(XCpuImpl impl)
+{
+	if (impl < 0 || impl >= XIMPL_COUNT)
+		return "";
+	return impl_names[impl];
+}
+
+/////////////////////////////////////////////////////////////////
+/// ӡCPUԺÿ㷨ʹõʵ
+void XCpu::Print()
+{
+	XCpuInfo hw = Hardware();
+	XCpuInfo cpu = Active();
+	struct { const char* name; bool hw; bool on; } features[] = {
+		{ "SSSE3", hw.ssse3, cpu.ssse3 },
+		{ "PCLMUL", hw.pclmul, cpu.pclmul },
+		{ "MOVBE", hw.movbe, cpu.movbe },
+		{ "AES-NI", hw.aesni, cpu.aesni },
+		{ "AVX", hw.avx, cpu.avx },
+		{ "AVX2", hw.avx2, cpu.avx2 },
+		{ "AVX512F", hw.avx512f, cpu.avx512f },
+		{ "AVX512IFMA", hw.avx512ifma, cpu.avx512ifma },
+		{ "SHA", hw.sha, cpu.sha },
+		{ "VAES", hw.vaes, cpu.vaes },
+		{ "VPCLMULQDQ", hw.vpclmul, cpu.vpclmul },
+	};
+	const char* env = getenv(XCPU_ENV);
+	cout << OpenSSL_version(OPENSSL_VERSION) << endl;
+	cout << XCPU_ENV << "=" << (env ? env : "") << " (" << ImplName(CurrentImpl()) << ")" << endl;
+	cout << "CPU:";
+	for (auto& f : features)
+	{
+		if (!f.hw) continue;
+		//Ӳֵ֧εԼ'-'
+		cout << " " << (f.on ? "" : "-") << f.name;
+	}
+	cout << endl;
+
+	struct { XSecType type; const char* name; } types[] = {
+		{ XDES_CBC, "XDES_CBC" },
+		{ X3DES_CBC, "X3DES_CBC" },
+		{ XAES128_ECB, "XAES128_ECB" },
+		{ XAES128_CBC, "XAES128_CBC" },
+		{ XAES128_CTR, "XAES128_CTR" },
+		{ XAES128_GCM, "XAES128_GCM" },
+		{ XSM4_CBC, "XSM4_CBC" },
+		{ XSM4_GCM, "XSM4_GCM" },
+		{ XCHACHA20_POLY1305, "XCHACHA20_POLY1305" },
+	};
+	for (auto& t : types)
+	{
+		cout << "  " << t.name << ": " << ImplName(t.type) << endl;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include "XSec.h"
+
+//OpenSSLѡʵ֣ͨOPENSSL_ia32capCPUǿѡ
+enum XCpuImpl
+{
+	XIMPL_AUTO,			//ԶѡʹCPUֵ֧ʵ
+	XIMPL_NO_AVX512,	//AVX-512VAES
+	XIMPL_NO_AVX,		//AVX AVX2 AVX-512
+	XIMPL_NO_AESNI,		//AES-NI PCLMULAESʹSSSE3vpaes
+	XIMPL_GENERIC,		//ֻͨC
+	XIMPL_COUNT
+};
+
+//CPU
+struct XCpuInfo
+{
+	bool ssse3 = false;
+	bool pclmul = false;
+	bool movbe = false;
+	bool aesni = false;
+	bool avx = false;
+	bool avx2 = false;
+	bool avx512f = false;
+	bool avx512bw = false;
+	bool avx512vl = false;
+	bool avx512ifma = false;
+	bool sha = false;
+	bool vaes = false;
+	bool vpclmul = false;
+};
+
+/*
+XCpu::Print();
+cout << XCpu::ImplName(XAES128_GCM) << endl;
+//ӽЧǰOpenSSLѾʼ
+XCpu::SetImpl(XIMPL_NO_AESNI);
+system("test_evp_cipher cpu");
+*/
+class XCpu
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// CPUӲֵ֧ԣcpuidͲϵͳǷ񱣴AVXĴ
+	static XCpuInfo Hardware();
+
+	/////////////////////////////////////////////////////////////////
+	/// OpenSSLʵʹõԣӲ԰OPENSSL_ia32capκĽ
+	static XCpuInfo Active();
+
+	/////////////////////////////////////////////////////////////////
+	/// 㷨ڵǰCPUOpenSSLѡʵ
+	/// @para type 㷨
+	/// @return ʵƣ"AES-NI" "vpaes(SSSE3)" "C"
+	static std::string ImplName(XSecType type);
+
+	/////////////////////////////////////////////////////////////////
+	/// ǿOpenSSLʹָʵ֣ûOPENSSL_ia32cap
+	/// OpenSSLʱȡһΣֻ֮ӽЧ
+	/// @para impl ʵ
+	/// @return ɹtruex86ƽ̨false
+	static bool SetImpl(XCpuImpl impl);
+
+	/////////////////////////////////////////////////////////////////
+	/// ǰ̵OPENSSL_ia32capӦʵ֣SetImplõֵXIMPL_AUTO
+	static XCpuImpl CurrentImpl();
+
+	//ʵֵ
+	static const char* ImplName(XCpuImpl impl);
+
+	/////////////////////////////////////////////////////////////////
+	/// ӡCPUԺÿ㷨ʹõʵ
+	static void Print();
+};
@@ -0,0 +1,852 @@
+#include "XEcc.h"
+#include "XThreadPool.h"
+#include <openssl/pem.h>
+#include <openssl/err.h>
+#include <openssl/ec.h>
+#include <openssl/bn.h>
+#include <openssl/rand.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <cstring>
+#include <chrono>
+using namespace std;
+
+//SM2ͱֽ
+#define SM2_SIZE 32
+
+//SM3ժҪֽ
+#define SM3_SIZE 32
+
+//SM2ߣֻ̹߳
+static const EC_GROUP* Sm2Group()
+{
+	static EC_GROUP* group = EC_GROUP_new_by_curve_name(NID_sm2);
+	return group;
+}
+
+//PrecomputeĽõĹԿ㣬ʱÿδEVP_PKEYȡ
+struct XEccPrecomp
+{
+	EC_POINT* q = nullptr;
+
+	XEccPrecomp() {}
+	XEccPrecomp(const XEccPrecomp&) = delete;
+	XEccPrecomp& operator=(const XEccPrecomp&) = delete;
+	~XEccPrecomp() { EC_POINT_free(q); }
+};
+
+//SM2ԿX9.63 KDFʹSM3SM3(x2 || y2 || )1ʼ32λ
+static bool Sm2Kdf(const unsigned char* x2y2, unsigned char* out, int size)
+{
+	unsigned char in[SM2_SIZE * 2 + 4];
+	unsigned char md[SM3_SIZE];
+	memcpy(in, x2y2, SM2_SIZE * 2);
+	for (unsigned int ct = 1; size > 0; ct++)
+	{
+		in[SM2_SIZE * 2] = (unsigned char)(ct >> 24);
+		in[SM2_SIZE * 2 + 1] = (unsigned char)(ct >> 16);
+		in[SM2_SIZE * 2 + 2] = (unsigned char)(ct >> 8);
+		in[SM2_SIZE * 2 + 3] = (unsigned char)ct;
+		if (EVP_Digest(in, sizeof(in), md, NULL, EVP_sm3(), NULL) != 1)
+			return false;
+		int n = size < SM3_SIZE ? size : SM3_SIZE;
+		memcpy(out, md, n);
+		out += n;
+		size -= n;
+	}
+	OPENSSL_cleanse(in, sizeof(in));
+	OPENSSL_cleanse(md, sizeof(md));
+	return true;
+}
+
+//DERȣ128óʽ0x80|ֽ֮Ǵ˳ȣ0x810x84
+static void DerLen(vector<unsigned char>& out, size_t len)
+{
+	if (len < 0x80)
+	{
+		out.push_back((unsigned char)len);
+		return;
+	}
+	int bytes = 0;
+	for (size_t v = len; v > 0; v >>= 8)
+		bytes++;
+	out.push_back((unsigned char)(0x80 | bytes));
+	for (int i = bytes - 1; i >= 0; i--)
+		out.push_back((unsigned char)(len >> (i * 8)));
+}
+
+//DER޷ȥǰ0λΪ1ʱһ0
+static void DerInt(vector<unsigned char>& out, const unsigned char* v, int size)
+{
+	while (size > 1 && v[0] == 0)
+	{
+		v++;
+		size--;
+	}
+	int pad = (v[0] & 0x80) ? 1 : 0;
+	out.push_back(0x02);
+	DerLen(out, size + pad);
+	if (pad)
+		out.push_back(0);
+	out.insert(out.end(), v, v + size);
+}
+
+//DERֽڴ
+static void DerOctet(vector<unsigned char>& out, const unsigned char* v, int size)
+{
+	out.push_back(0x04);
+	DerLen(out, size);
+	out.insert(out.end(), v, v + size);
+}
+
+//Կţÿμؼһ
+static atomic<long long> ecc_key_id(0);
+
+//һԿһ߳е
+//ӽѾinitãǩǩinitģ壬ÿθƺʹ
+struct XEccCtx
+{
+	EVP_PKEY_CTX* en = nullptr;
+	EVP_PKEY_CTX* de = nullptr;
+	EVP_MD_CTX* sign = nullptr;
+	EVP_MD_CTX* verify = nullptr;
+
+	//ģõģÿʹǰ
+	EVP_MD_CTX* md = nullptr;
+
+	//ԿCloseʧЧʱͷ
+	weak_ptr<void> owner;
+
+	//һʹõţʱͷС
+	unsigned long long last_use = 0;
+
+	XEccCtx() {}
+	XEccCtx(const XEccCtx&) = delete;
+	XEccCtx& operator=(const XEccCtx&) = delete;
+	~XEccCtx()
+	{
+		EVP_PKEY_CTX_free(en);
+		EVP_PKEY_CTX_free(de);
+		EVP_MD_CTX_free(sign);
+		EVP_MD_CTX_free(verify);
+		EVP_MD_CTX_free(md);
+	}
+};
+
+//ǰ̵߳Ļ棬keyΪԿţ߳˳ʱͷ
+static map<long long, unique_ptr<XEccCtx> >& ThreadCtxMap()
+{
+	static thread_local map<long long, unique_ptr<XEccCtx> > ctxs;
+	return ctxs;
+}
+
+//ȡǰ߳ŵԿģû򴴽
+//½ǰͷCloseԿģȻXECC_CTX_MAXʱͷûʹõ
+static XEccCtx* ThreadEntry(long long id, const shared_ptr<void>& alive)
+{
+	static thread_local unsigned long long use_count = 0;
+	auto& ctxs = ThreadCtxMap();
+	auto it = ctxs.find(id);
+	if (it == ctxs.end())
+	{
+		for (auto i = ctxs.begin(); i != ctxs.end();)
+		{
+			if (i->second->owner.expired())
+				i = ctxs.erase(i);
+			else
+				++i;
+		}
+		if (ctxs.size() >= XECC_CTX_MAX)
+		{
+			auto lru = ctxs.begin();
+			for (auto i = ctxs.begin(); i != ctxs.end(); ++i)
+			{
+				if (i->second->last_use < lru->second->last_use)
+					lru = i;
+			}
+			ctxs.erase(lru);
+		}
+		it = ctxs.emplace(id, unique_ptr<XEccCtx>(new XEccCtx)).first;
+		it->second->owner = alive;
+	}
+	it->second->last_use = ++use_count;
+	return it->second.get();
+}
+
+//ȡǰ߳Կļܻģһεʱʼ
+EVP_PKEY_CTX* XEccKey::ThreadCtx(bool is_en)
+{
+	if (!pkey_)
+		return NULL;
+	XEccCtx* entry = ThreadEntry(id_, alive_);
+	EVP_PKEY_CTX*& ctx = is_en ? entry->en : entry->de;
+	if (ctx)
+		return ctx;
+	ctx = EVP_PKEY_CTX_new(pkey_, NULL);
+	if (!ctx)
+		return NULL;
+	int re = is_en ? EVP_PKEY_encrypt_init(ctx) : EVP_PKEY_decrypt_init(ctx);
+	if (re != 1)
+	{
+		ERR_print_errors_fp(stderr);
+		EVP_PKEY_CTX_free(ctx);
+		ctx = NULL;
+	}
+	return ctx;
+}
+
+//initǩǩģ壬ʧܷNULL
+//SM2SM3ĬûIDECԿECDSA SHA-256
+static EVP_MD_CTX* NewMdCtx(EVP_PKEY* pkey, bool is_sign)
+{
+	EVP_MD_CTX* tmpl = EVP_MD_CTX_new();
+	if (!tmpl)
+		return NULL;
+	bool is_sm2 = EVP_PKEY_is_a(pkey, "SM2");
+	const EVP_MD* type = is_sm2 ? EVP_sm3() : EVP_sha256();
+	EVP_PKEY_CTX* pctx = NULL;
+	int re = is_sign ? EVP_DigestSignInit(tmpl, &pctx, type, NULL, pkey)
+		: EVP_DigestVerifyInit(tmpl, &pctx, type, NULL, pkey);
+
+	//Zֵ = SM3(ID ID ߲ Կ)ڵһUpdateʱ
+	if (re == 1 && is_sm2)
+		re = EVP_PKEY_CTX_set1_id(pctx, XECC_SM2_ID, strlen(XECC_SM2_ID));
+	if (re != 1)
+	{
+		ERR_print_errors_fp(stderr);
+		EVP_MD_CTX_free(tmpl);
+		return NULL;
+	}
+	return tmpl;
+}
+
+//ȡǰ߳Կǩǩģinitģ壬ʧܷNULL
+EVP_MD_CTX* XEccKey::ThreadMdCtx(bool is_sign)
+{
+	if (!pkey_)
+		return NULL;
+	XEccCtx* entry = ThreadEntry(id_, alive_);
+	EVP_MD_CTX*& tmpl = is_sign ? entry->sign : entry->verify;
+	if (!tmpl)
+		tmpl = NewMdCtx(pkey_, is_sign);
+	if (!tmpl)
+		return NULL;
+	if (!entry->md)
+		entry->md = EVP_MD_CTX_new();
+	if (!entry->md || EVP_MD_CTX_copy_ex(entry->md, tmpl) != 1)
+	{
+		ERR_print_errors_fp(stderr);
+		return NULL;
+	}
+	return entry->md;
+}
+
+//ǰ߳ԿģѾkeygen_initߣ
+static EVP_PKEY_CTX* ThreadGenCtx(XEccCurve curve)
+{
+	struct GenHolder
+	{
+		EVP_PKEY_CTX* ctx[2] = { nullptr, nullptr };
+		~GenHolder()
+		{
+			EVP_PKEY_CTX_free(ctx[0]);
+			EVP_PKEY_CTX_free(ctx[1]);
+		}
+	};
+	static thread_local GenHolder holder;
+	int index = curve == XECC_SM2 ? 0 : 1;
+	EVP_PKEY_CTX*& ctx = holder.ctx[index];
+	if (ctx)
+		return ctx;
+	ctx = EVP_PKEY_CTX_new_from_name(NULL, curve == XECC_SM2 ? "SM2" : "EC", NULL);
+	int re = ctx ? EVP_PKEY_keygen_init(ctx) : 0;
+	if (re == 1 && curve != XECC_SM2)
+		re = EVP_PKEY_CTX_set_group_name(ctx, "secp256k1");
+	if (re != 1)
+	{
+		ERR_print_errors_fp(stderr);
+		EVP_PKEY_CTX_free(ctx);
+		ctx = NULL;
+	}
+	return ctx;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ڴµԿ
+bool XEccKey::Generate(XEccCurve curve)
+{
+	Close();
+	auto ctx = ThreadGenCtx(curve);
+	if (!ctx)
+		return false;
+	if (EVP_PKEY_generate(ctx, &pkey_) != 1)
+	{
+		ERR_print_errors_fp(stderr);
+		pkey_ = nullptr;
+		return false;
+	}
+	is_private_ = true;
+	id_ = ++ecc_key_id;
+	alive_ = make_shared<char>(0);
+	return true;
+}
+
+//ԿдBIOPEMDER
+static bool WriteKey(BIO* bio, EVP_PKEY* pkey, bool is_private, bool is_pem)
+{
+	int re = 0;
+	if (is_pem)
+		re = is_private ? PEM_write_bio_PrivateKey(bio, pkey, NULL, NULL, 0, NULL, NULL)
+			: PEM_write_bio_PUBKEY(bio, pkey);
+	else
+		re = is_private ? i2d_PKCS8PrivateKey_bio(bio, pkey, NULL, NULL, 0, NULL, NULL)
+			: i2d_PUBKEY_bio(bio, pkey);
+	if (re != 1)
+		ERR_print_errors_fp(stderr);
+	return re == 1;
+}
+
+/////////////////////////////////////////////////////////////////
+/// PEMʽԿ
+std::string XEccKey::ToPEM(bool is_private)
+{
+	string out;
+	if (!pkey_ || (is_private && !is_private_))
+		return out;
+	BIO* bio = BIO_new(BIO_s_mem());
+	if (!bio)
+		return out;
+	if (WriteKey(bio, pkey_, is_private, true))
+	{
+		char* data = NULL;
+		long size = BIO_get_mem_data(bio, &data);
+		out.assign(data, size);
+	}
+	BIO_free(bio);
+	return out;
+}
+
+/////////////////////////////////////////////////////////////////
+/// DERʽԿ
+std::vector<unsigned char> XEccKey::ToDER(bool is_private)
+{
+	vector<unsigned char> out;
+	if (!pkey_ || (is_private && !is_private_))
+		return out;
+	BIO* bio = BIO_new(BIO_s_mem());
+	if (!bio)
+		return out;
+	if (WriteKey(bio, pkey_, is_private, false))
+	{
+		char* data = NULL;
+		long size = BIO_get_mem_data(bio, &data);
+		out.assign(data, data + size);
+	}
+	BIO_free(bio);
+	return out;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ToPEMĽдļ
+bool XEccKey::WritePEM(std::string filename, bool is_private)
+{
+	if (!pkey_ || (is_private && !is_private_))
+		return false;
+	BIO* bio = BIO_new_file(filename.c_str(), "w");
+	if (!bio)
+	{
+		ERR_clear_error();
+		return false;
+	}
+	bool is_ok = WriteKey(bio, pkey_, is_private, true);
+	BIO_free(bio);
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ȡPEMʽĹԿ֮ǰԿ
+bool XEccKey::LoadPublicKey(std::string filename)
+{
+	Close();
+	//BIOļFILE*CRTOpenSSLWindowsҪapplink
+	BIO* bio = BIO_new_file(filename.c_str(), "r");
+	if (!bio)
+	{
+		ERR_clear_error();
+		return false;
+	}
+	pkey_ = PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
+	BIO_free(bio);
+	if (!pkey_)
+	{
+		ERR_print_errors_fp(stderr);
+		return false;
+	}
+	id_ = ++ecc_key_id;
+	alive_ = make_shared<char>(0);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ȡPEMʽ˽Կ֮ǰԿ
+bool XEccKey::LoadPrivateKey(std::string filename)
+{
+	Close();
+	BIO* bio = BIO_new_file(filename.c_str(), "r");
+	if (!bio)
+	{
+		ERR_clear_error();
+		return false;
+	}
+	pkey_ = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+	BIO_free(bio);
+	if (!pkey_)
+	{
+		ERR_print_errors_fp(stderr);
+		return false;
+	}
+	is_private_ = true;
+	id_ = ++ecc_key_id;
+	alive_ = make_shared<char>(0);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// SM2ܣȡĴСټ
+bool XEccKey::Encrypt(const unsigned char* in, int in_size, std::vector<unsigned char>& out)
+{
+	XEccPrecomp* pre = precomp_.load(memory_order_acquire);
+	if (pre)
+		return EncryptPrecomp(pre, in, in_size, out);
+	auto ctx = ThreadCtx(true);
+	if (!ctx)
+		return false;
+	bool is_ok = false;
+	size_t out_len = 0;
+	if (EVP_PKEY_encrypt(ctx, NULL, &out_len, in, in_size) == 1)
+	{
+		out.resize(out_len);
+		if (EVP_PKEY_encrypt(ctx, out.data(), &out_len, in, in_size) == 1)
+		{
+			out.resize(out_len);
+			is_ok = true;
+		}
+	}
+	if (!is_ok)
+		ERR_print_errors_fp(stderr);
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// SM2
+bool XEccKey::Decrypt(const unsigned char* in, int in_size, std::vector<unsigned char>& out)
+{
+	if (!is_private_)
+		return false;
+	auto ctx = ThreadCtx(false);
+	if (!ctx)
+		return false;
+	bool is_ok = false;
+	size_t out_len = 0;
+	if (EVP_PKEY_decrypt(ctx, NULL, &out_len, in, in_size) == 1)
+	{
+		out.resize(out_len);
+		if (EVP_PKEY_decrypt(ctx, out.data(), &out_len, in, in_size) == 1)
+		{
+			out.resize(out_len);
+			is_ok = true;
+		}
+	}
+
+	//ı۸ʱʧ
+	ERR_clear_error();
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ǩSM2ԿSM2ǩSM3ECԿECDSASHA-256
+bool XEccKey::Sign(const unsigned char* data, int size, std::vector<unsigned char>& sig)
+{
+	if (!is_private_)
+		return false;
+	auto md = ThreadMdCtx(true);
+	if (!md)
+		return false;
+	size_t sig_len = EVP_PKEY_get_size(pkey_);
+	sig.resize(sig_len);
+	if (EVP_DigestSign(md, sig.data(), &sig_len, data, size) != 1)
+	{
+		ERR_print_errors_fp(stderr);
+		sig.clear();
+		return false;
+	}
+	sig.resize(sig_len);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ֤ǩ
+bool XEccKey::Verify(const unsigned char* data, int size, const unsigned char* sig, int sig_size)
+{
+	if (!sig || sig_size <= 0)
+		return false;
+	auto md = ThreadMdCtx(false);
+	if (!md)
+		return false;
+	bool is_ok = EVP_DigestVerify(md, sig, sig_size, data, size) == 1;
+
+	//ǩ
+	ERR_clear_error();
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ֤ǩ̳߳вд
+int XEccKey::VerifyBatch(XEccVerifyItem* items, int count)
+{
+	if (!items || count <= 0)
+		return 0;
+
+	//߳ҲִУ߳+1ֶΣÿ
+	auto pool = XThreadPool::Instance();
+	int task_count = pool->thread_count() + 1;
+	if (task_count > count)
+		task_count = count;
+	atomic<int> ok_count(0);
+	vector<function<void()> > tasks;
+	for (int t = 0; t < task_count; t++)
+	{
+		int begin = (int)((long long)count * t / task_count);
+		int end = (int)((long long)count * (t + 1) / task_count);
+		//ǩģ尴ߴԿֻڱʹãǩٶҲռ̻߳
+		tasks.push_back([=, &ok_count] {
+			map<XEccKey*, EVP_MD_CTX*> tmpls;
+			EVP_MD_CTX* md = EVP_MD_CTX_new();
+			for (int i = begin; i < end; i++)
+			{
+				XEccVerifyItem& item = items[i];
+				item.is_ok = false;
+				if (!md || !item.key || !item.key->pkey_ || !item.sig || item.sig_size <= 0)
+					continue;
+				EVP_MD_CTX*& tmpl = tmpls[item.key];
+				if (!tmpl)
+					tmpl = NewMdCtx(item.key->pkey_, false);
+				if (!tmpl || EVP_MD_CTX_copy_ex(md, tmpl) != 1)
+					continue;
+				item.is_ok = EVP_DigestVerify(md, item.sig, item.sig_size, item.data, item.size) == 1;
+				if (item.is_ok)
+					ok_count++;
+			}
+
+			//ǩ
+			ERR_clear_error();
+			for (auto& t : tmpls)
+				EVP_MD_CTX_free(t.second);
+			EVP_MD_CTX_free(md);
+		});
+	}
+	pool->Run(tasks);
+	return ok_count;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ΪԿԤȽԿ
+bool XEccKey::Precompute()
+{
+	if (precomp_.load(memory_order_acquire))
+		return true;
+	if (!pkey_ || !EVP_PKEY_is_a(pkey_, "SM2"))
+		return false;
+
+	//Կ㣬δѹʽ 04 || x || y
+	unsigned char pub[SM2_SIZE * 2 + 1] = { 0 };
+	size_t pub_size = 0;
+	if (EVP_PKEY_get_octet_string_param(pkey_, OSSL_PKEY_PARAM_PUB_KEY, pub, sizeof(pub), &pub_size) != 1)
+	{
+		ERR_print_errors_fp(stderr);
+		return false;
+	}
+	auto group = Sm2Group();
+	BN_CTX* bn = BN_CTX_new();
+	XEccPrecomp* pre = new XEccPrecomp;
+	pre->q = EC_POINT_new(group);
+	bool is_ok = bn && pre->q
+		&& EC_POINT_oct2point(group, pre->q, pub, pub_size, bn) == 1
+		&& !EC_POINT_is_at_infinity(group, pre->q);
+	BN_CTX_free(bn);
+	if (!is_ok)
+	{
+		ERR_print_errors_fp(stderr);
+		delete pre;
+		return false;
+	}
+
+	//߳ѾɣĽ
+	XEccPrecomp* expected = nullptr;
+	if (!precomp_.compare_exchange_strong(expected, pre, memory_order_acq_rel))
+		delete pre;
+	return true;
+}
+
+//ʹԤȽĹԿSM2ܣEVP_PKEY_encryptʽͬ
+//C1 = kG(x2, y2) = kPC2 = M xor KDF(x2 || y2)C3 = SM3(x2 || M || y2)
+//DER SEQUENCE { INTEGER x1, INTEGER y1, OCTET STRING C3, OCTET STRING C2 }
+bool XEccKey::EncryptPrecomp(XEccPrecomp* pre, const unsigned char* in, int in_size, std::vector<unsigned char>& out)
+{
+	if (!in || in_size <= 0)
+		return false;
+	auto group = Sm2Group();
+	BN_CTX* bn = BN_CTX_new();
+	EC_POINT* c1 = EC_POINT_new(group);
+	EC_POINT* kp = EC_POINT_new(group);
+	if (!bn || !c1 || !kp)
+	{
+		BN_CTX_free(bn);
+		EC_POINT_free(c1);
+		EC_POINT_free(kp);
+		return false;
+	}
+	BN_CTX_start(bn);
+	BIGNUM* k = BN_CTX_get(bn);
+	BIGNUM* x = BN_CTX_get(bn);
+	BIGNUM* y = BN_CTX_get(bn);
+	const BIGNUM* order = EC_GROUP_get0_order(group);
+
+	unsigned char x1y1[SM2_SIZE * 2] = { 0 };
+	unsigned char x2y2[SM2_SIZE * 2] = { 0 };
+	vector<unsigned char> c2(in_size);
+	unsigned char c3[SM3_SIZE] = { 0 };
+	bool is_ok = false;
+
+	//k[1, n-1]ѡȡKDFȫ0ʱѡȡ
+	for (int retry = 0; y && retry < 8 && !is_ok; retry++)
+	{
+		if (BN_priv_rand_range(k, order) != 1)
+			break;
+		if (BN_is_zero(k))
+			continue;
+
+		//OpenSSLʹɸӣÿһλͬĵ㣬ʱk޹
+		if (EC_POINT_mul(group, c1, k, NULL, NULL, bn) != 1
+			|| EC_POINT_mul(group, kp, NULL, pre->q, k, bn) != 1)
+			break;
+		if (EC_POINT_get_affine_coordinates(group, c1, x, y, bn) != 1
+			|| BN_bn2binpad(x, x1y1, SM2_SIZE) != SM2_SIZE
+			|| BN_bn2binpad(y, x1y1 + SM2_SIZE, SM2_SIZE) != SM2_SIZE)
+			break;
+		if (EC_POINT_get_affine_coordinates(group, kp, x, y, bn) != 1
+			|| BN_bn2binpad(x, x2y2, SM2_SIZE) != SM2_SIZE
+			|| BN_bn2binpad(y, x2y2 + SM2_SIZE, SM2_SIZE) != SM2_SIZE)
+			break;
+		if (!Sm2Kdf(x2y2, c2.data(), in_size))
+			break;
+		bool is_zero = true;
+		for (int i = 0; i < in_size; i++)
+		{
+			if (c2[i] != 0)
+			{
+				is_zero = false;
+				break;
+			}
+		}
+		if (is_zero)
+			continue;
+		for (int i = 0; i < in_size; i++)
+			c2[i] ^= in[i];
+
+		EVP_MD_CTX* md = EVP_MD_CTX_new();
+		is_ok = md
+			&& EVP_DigestInit_ex(md, EVP_sm3(), NULL) == 1
+			&& EVP_DigestUpdate(md, x2y2, SM2_SIZE) == 1
+			&& EVP_DigestUpdate(md, in, in_size) == 1
+			&& EVP_DigestUpdate(md, x2y2 + SM2_SIZE, SM2_SIZE) == 1
+			&& EVP_DigestFinal_ex(md, c3, NULL) == 1;
+		EVP_MD_CTX_free(md);
+		if (!is_ok)
+			break;
+	}
+	if (is_ok)
+	{
+		vector<unsigned char> body;
+		DerInt(body, x1y1, SM2_SIZE);
+		DerInt(body, x1y1 + SM2_SIZE, SM2_SIZE);
+		DerOctet(body, c3, SM3_SIZE);
+		DerOctet(body, c2.data(), in_size);
+		out.clear();
+		out.push_back(0x30);
+		DerLen(out, body.size());
+		out.insert(out.end(), body.begin(), body.end());
+	}
+	else
+	{
+		ERR_print_errors_fp(stderr);
+	}
+	OPENSSL_cleanse(x2y2, sizeof(x2y2));
+	BN_clear(k);
+	BN_CTX_end(bn);
+	BN_CTX_free(bn);
+	EC_POINT_clear_free(c1);
+	EC_POINT_clear_free(kp);
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ͷԿ
+void XEccKey::Close()
+{
+	delete precomp_.exchange(nullptr);
+	if (pkey_)
+		EVP_PKEY_free(pkey_);
+	pkey_ = nullptr;
+	is_private_ = false;
+	id_ = 0;
+
+	//̻߳´βʱͷ
+	alive_.reset();
+}
+
+/////////////////////////////////////////////////////////////////
+/// ȫԿ
+XEccKeyStore* XEccKeyStore::Instance()
+{
+	static XEccKeyStore store;
+	return &store;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ȡԿһεʱȡļֱ֮ӷػ
+std::shared_ptr<XEccKey> XEccKeyStore::PublicKey(std::string filename, bool is_precompute)
+{
+	auto key = Get(filename, false);
+	if (key && is_precompute)
+		key->Precompute();
+	return key;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ȡ˽Կһεʱȡļֱ֮ӷػ
+std::shared_ptr<XEccKey> XEccKeyStore::PrivateKey(std::string filename)
+{
+	return Get(filename, true);
+}
+
+//ȡԿûȡļ
+std::shared_ptr<XEccKey> XEccKeyStore::Get(std::string filename, bool is_private)
+{
+	string k = (is_private ? "pri:" : "pub:") + filename;
+	unique_lock<mutex> lock(mux_);
+	auto it = keys_.find(k);
+	if (it != keys_.end())
+		return it->second;
+	shared_ptr<XEccKey> key(new XEccKey);
+	bool is_ok = is_private ? key->LoadPrivateKey(filename) : key->LoadPublicKey(filename);
+	if (!is_ok)
+		return nullptr;
+	keys_[k] = key;
+	return key;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ɾļӦĻ
+void XEccKeyStore::Remove(std::string filename)
+{
+	unique_lock<mutex> lock(mux_);
+	keys_.erase("pub:" + filename);
+	keys_.erase("pri:" + filename);
+}
+
+/////////////////////////////////////////////////////////////////
+/// ջ
+void XEccKeyStore::Clear()
+{
+	unique_lock<mutex> lock(mux_);
+	keys_.clear();
+}
+
+/////////////////////////////////////////////////////////////////
+/// ̨߳
+void XEccKeyPool::Start(int size, XEccCurve curve, int thread_count)
+{
+	Stop();
+	if (thread_count <= 0)
+		thread_count = 1;
+	max_size_ = size;
+	curve_ = curve;
+	is_exit_ = false;
+	for (int i = 0; i < thread_count; i++)
+		threads_.push_back(thread(&XEccKeyPool::Work, this));
+}
+
+/////////////////////////////////////////////////////////////////
+/// ȡһµԿ
+std::shared_ptr<XEccKey> XEccKeyPool::Get()
+{
+	{
+		unique_lock<mutex> lock(mux_);
+		if (!keys_.empty())
+		{
+			auto key = keys_.front();
+			keys_.pop_front();
+			lock.unlock();
+			cv_.notify_one();
+			return key;
+		}
+	}
+	miss_count_++;
+	shared_ptr<XEccKey> key(new XEccKey);
+	if (!key->Generate(curve_))
+		return nullptr;
+	return key;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ֹ̨̣ͣ߳ճ
+void XEccKeyPool::Stop()
+{
+	{
+		unique_lock<mutex> lock(mux_);
+		is_exit_ = true;
+	}
+	cv_.notify_all();
+	for (auto& th : threads_)
+	{
+		if (th.joinable())
+			th.join();
+	}
+	threads_.clear();
+	unique_lock<mutex> lock(mux_);
+	keys_.clear();
+}
+
+/////////////////////////////////////////////////////////////////
+/// еԿ
+int XEccKeyPool::size()
+{
+	unique_lock<mutex> lock(mux_);
+	return (int)keys_.size();
+}
+
+//̨߳ڣزʱɣ
+void XEccKeyPool::Work()
+{
+	for (;;)
+	{
+		{
+			unique_lock<mutex> lock(mux_);
+			cv_.wait(lock, [this] { return is_exit_ || (int)keys_.size() < max_size_; });
+			if (is_exit_)
+				return;
+		}
+		shared_ptr<XEccKey> key(new XEccKey);
+		if (!key->Generate(curve_))
+		{
+			//ʧܣ߲֧֣ռCPU
+			unique_lock<mutex> lock(mux_);
+			cv_.wait_for(lock, chrono::seconds(1), [this] { return is_exit_; });
+			continue;
+		}
+		unique_lock<mutex> lock(mux_);
+		if ((int)keys_.size() < max_size_)
+			keys_.push_back(key);
+	}
+}
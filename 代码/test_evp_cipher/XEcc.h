@@ -0,0 +1,293 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <openssl/evp.h>
+
+//ÿ̻߳ԿͷŸ߳ûʹõ
+#define XECC_CTX_MAX 64
+
+//SM2ǩĬûIDGM/T 0009
+#define XECC_SM2_ID "1234567812345678"
+
+//ԿĬϱֵԿ
+#define XECC_POOL_SIZE 64
+
+//Կʹõ
+enum XEccCurve
+{
+	XECC_SM2,		//SM2ּ֧ӽܺǩ
+	XECC_SECP256K1	//رҡ̫˻ʹãֻ֧ǩ
+};
+
+//PrecomputeĽXEcc.cpp
+struct XEccPrecomp;
+
+class XEccKey;
+
+//֤ǩһ
+struct XEccVerifyItem
+{
+	//ǩ߹ԿVerifyBatchǰClose
+	XEccKey* key = nullptr;
+
+	//ǩ
+	const unsigned char* data = nullptr;
+	int size = 0;
+
+	//DERǩ
+	const unsigned char* sig = nullptr;
+	int sig_size = 0;
+
+	//֤
+	bool is_ok = false;
+};
+
+/*
+SM2Կӽܺǩsecp256k1ECԿֻǩECDSA
+ԿļECCĿEccKey()ɵpubkey.pem private_pemʽͬ
+XEccKey key;
+key.LoadPublicKey("pubkey.pem");
+std::vector<unsigned char> out;
+key.Encrypt(data, size, out);
+
+غԿڶ߳ͬʱʹãÿ̵߳һʹʱʼԼģ֮
+
+ܸͬһշԿʱԤȽԿ
+key.Precompute();
+key.Encrypt(data, size, out);	//EVP_PKEY_encryptĸʽ
+
+֤һֽ߶ CID+ek ǩ
+std::vector<XEccVerifyItem> items(n);
+items[i].key = owner_key; items[i].data = ...; items[i].sig = ...;
+XEccKey::VerifyBatch(items.data(), n);
+*/
+class XEccKey
+{
+public:
+	XEccKey() {}
+
+	//Կܸ
+	XEccKey(const XEccKey&) = delete;
+	XEccKey& operator=(const XEccKey&) = delete;
+
+	/////////////////////////////////////////////////////////////////
+	/// ȡPEMʽĹԿ֮ǰԿ
+	/// @para filename Կļ
+	/// @return ļڻʽ󷵻false
+	bool LoadPublicKey(std::string filename);
+
+	/////////////////////////////////////////////////////////////////
+	/// ȡPEMʽ˽Կ֮ǰԿ˽ԿҲԼ
+	/// @para filename ˽ԿļEC PRIVATE KEYPRIVATE KEYʽ
+	/// @return ļڻʽ󷵻false
+	bool LoadPrivateKey(std::string filename);
+
+	/////////////////////////////////////////////////////////////////
+	/// ڴµԿԣ֮ǰԿдļ
+	/// ÿ̻߳Լ
+	/// @para curve 
+	/// @return ɹtrue
+	bool Generate(XEccCurve curve = XECC_SM2);
+
+	/////////////////////////////////////////////////////////////////
+	/// PEMʽԿԿΪPUBLIC KEY˽ԿΪܵPRIVATE KEYPKCS#8
+	/// @para is_private ˽Կû˽Կʱʧ
+	/// @return ʧܷؿַ
+	std::string ToPEM(bool is_private = false);
+
+	/////////////////////////////////////////////////////////////////
+	/// DERʽԿʽͬToPEM
+	/// @return ʧܷؿ
+	std::vector<unsigned char> ToDER(bool is_private = false);
+
+	/////////////////////////////////////////////////////////////////
+	/// ToPEMĽдļLoadPublicKey LoadPrivateKeyȡ
+	/// @return ʧܷfalse
+	bool WritePEM(std::string filename, bool is_private = false);
+
+	/////////////////////////////////////////////////////////////////
+	/// SM2ܣֻʺϼԿСݣıĶԼ100ֽ
+	/// ʹõǰ̻߳ģظԿͳʼ
+	/// @para in 
+	/// @para in_size ĴС
+	/// @para out DER
+	/// @return ûмԿSM2Կfalse
+	bool Encrypt(const unsigned char* in, int in_size, std::vector<unsigned char>& out);
+
+	/////////////////////////////////////////////////////////////////
+	/// SM2ܣʹõǰ̻߳
+	/// @para in DER
+	/// @para in_size ĴС
+	/// @para out 
+	/// @return û˽ԿĴ󷵻false
+	bool Decrypt(const unsigned char* in, int in_size, std::vector<unsigned char>& out);
+
+	/////////////////////////////////////////////////////////////////
+	/// ǩSM2ԿΪSM2ǩSM3ûIDΪXECC_SM2_IDECԿΪECDSASHA-256
+	/// ʹõǰ̻߳ǩ
+	/// @para data ǩ
+	/// @para size ݴС
+	/// @para sig DERǩ
+	/// @return û˽Կfalse
+	bool Sign(const unsigned char* data, int size, std::vector<unsigned char>& sig);
+
+	/////////////////////////////////////////////////////////////////
+	/// ֤ǩ㷨ͬSign
+	/// @para data ǩ
+	/// @para size ݴС
+	/// @para sig DERǩ
+	/// @para sig_size ǩС
+	/// @return ǩȷtrue
+	bool Verify(const unsigned char* data, int size, const unsigned char* sig, int sig_size);
+
+	/////////////////////////////////////////////////////////////////
+	/// ֤ǩ̳߳вд
+	/// ǩģ尴itemsеXEccKeyڱεнͷţռ̻߳
+	/// ͬһǩߵĶʹͬһXEccKeyÿֶֻʼһ
+	/// @para items ֤дis_ok
+	/// @para count 
+	/// @return ǩȷ
+	static int VerifyBatch(XEccVerifyItem* items, int count);
+
+	/////////////////////////////////////////////////////////////////
+	/// ΪԿԤȽԿ㣬֮EncryptֱӼkGkPÿξEVP_PKEY_encryptȡԿ
+	/// ʹOpenSSLɸӣʱk޹أʺϳʹõĽշԿ
+	/// ߳ʹԿʱãɺл
+	/// @return ûмԿSM2Կfalse
+	bool Precompute();
+
+	//ǷѾԤȽԿ
+	bool is_precompute() { return precomp_ != nullptr; }
+
+	/////////////////////////////////////////////////////////////////
+	/// ͷԿ
+	void Close();
+
+	//Ƿ˽Կ
+	bool is_private() { return is_private_; }
+
+	//OpenSSLԿûмʱΪNULL
+	EVP_PKEY* pkey() { return pkey_; }
+
+	~XEccKey() { Close(); }
+
+private:
+	//ȡǰ߳Կļܻģһεʱʼ
+	EVP_PKEY_CTX* ThreadCtx(bool is_en);
+
+	//ȡǰ߳Կǩǩģinitģ
+	EVP_MD_CTX* ThreadMdCtx(bool is_sign);
+
+	//ʹԤȽĹԿSM2
+	bool EncryptPrecomp(XEccPrecomp* pre, const unsigned char* in, int in_size, std::vector<unsigned char>& out);
+
+	EVP_PKEY* pkey_ = nullptr;
+	bool is_private_ = false;
+
+	//ÿμط±ţ̻߳水ŲңԿͷŻ¼غɵĲᱻ
+	long long id_ = 0;
+
+	//̻߳ĳweak_ptrCloseʱͷţݴͷԿ
+	std::shared_ptr<void> alive_;
+
+	//ԤȽĹԿ㣬ûеPrecomputeʱΪNULL
+	std::atomic<XEccPrecomp*> precomp_{ nullptr };
+};
+
+/*
+ļѽԿÿԿļֻȡһ
+auto key = XEccKeyStore::Instance()->PublicKey("pubkey.pem");
+if (key) key->Encrypt(data, size, out);
+*/
+class XEccKeyStore
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// ȫԿ
+	static XEccKeyStore* Instance();
+
+	/////////////////////////////////////////////////////////////////
+	/// ȡԿһεʱȡļֱ֮ӷػ
+	/// @para filename PEMԿļ
+	/// @para is_precompute ԤȽԿ㣬XEccKey::Precompute
+	/// @return ȡʧܷؿգʧܲ
+	std::shared_ptr<XEccKey> PublicKey(std::string filename, bool is_precompute = false);
+
+	/////////////////////////////////////////////////////////////////
+	/// ȡ˽Կһεʱȡļֱ֮ӷػ
+	/// @para filename PEM˽Կļ
+	/// @return ȡʧܷؿգʧܲ
+	std::shared_ptr<XEccKey> PrivateKey(std::string filename);
+
+	/////////////////////////////////////////////////////////////////
+	/// ɾļӦĻ棬ԿļºãѾȡԿȻ
+	void Remove(std::string filename);
+
+	/////////////////////////////////////////////////////////////////
+	/// ջ
+	void Clear();
+
+private:
+	//ȡԿûȡļ
+	std::shared_ptr<XEccKey> Get(std::string filename, bool is_private);
+
+	//keyΪ ˽Կ־+ļ
+	std::map<std::string, std::shared_ptr<XEccKey> > keys_;
+	std::mutex mux_;
+};
+
+/*
+ԤԿԣµ߻Ựֱȡãڵ߳еȴ
+XEccKeyPool pool;
+pool.Start();
+auto key = pool.Get();
+std::string pem = key->ToPEM(true);	//Ҫʱл
+*/
+class XEccKeyPool
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// ̨̣߳sizeʱɲ
+	/// @para size бֵԿ
+	/// @para curve 
+	/// @para thread_count ̨߳Сڵ0Ϊ1
+	void Start(int size = XECC_POOL_SIZE, XEccCurve curve = XECC_SM2, int thread_count = 1);
+
+	/////////////////////////////////////////////////////////////////
+	/// ȡһµԿԣÿԿֻȡһ
+	/// Ϊգδȡ̫죩ʱڵ߳
+	/// @return ʧܷؿ
+	std::shared_ptr<XEccKey> Get();
+
+	/////////////////////////////////////////////////////////////////
+	/// ֹ̨̣ͣ߳ճ
+	void Stop();
+
+	//еԿ
+	int size();
+
+	//Ϊʱڵ߳ɵĴ˵̫С̨̲߳
+	long long miss_count() { return miss_count_; }
+
+	~XEccKeyPool() { Stop(); }
+
+private:
+	//̨߳
+	void Work();
+
+	std::deque<std::shared_ptr<XEccKey> > keys_;
+	std::vector<std::thread> threads_;
+	std::mutex mux_;
+	std::condition_variable cv_;
+	bool is_exit_ = false;
+	int max_size_ = XECC_POOL_SIZE;
+	XEccCurve curve_ = XECC_SM2;
+	std::atomic<long long> miss_count_{ 0 };
+};
@@ -0,0 +1,236 @@
+#include "XEnvelope.h"
+#include "XThreadPool.h"
+#include <atomic>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+using namespace std;
+
+static const char BASE16_ENC_TAB[] = "0123456789ABCDEF";
+
+//ԿÿSealֻһΣnonce̶Ϊ0ظ
+static const unsigned char ENVELOPE_IV[16] = { 0 };
+
+//תBase16ıECCĿBase16Encodeͬ
+static string Base16Encode(const unsigned char* in, int size)
+{
+	string out;
+	out.resize(size * 2);
+	for (int i = 0; i < size; i++)
+	{
+		out[i * 2] = BASE16_ENC_TAB[in[i] >> 4];
+		out[i * 2 + 1] = BASE16_ENC_TAB[in[i] & 0x0F];
+	}
+	return out;
+}
+
+//Base16ıתƣСдԣзǷַfalse
+static bool Base16Decode(const string& in, vector<unsigned char>& out)
+{
+	if (in.size() % 2 != 0)
+		return false;
+	out.resize(in.size() / 2);
+	for (size_t i = 0; i < in.size(); i += 2)
+	{
+		int v[2] = { 0 };
+		for (int j = 0; j < 2; j++)
+		{
+			char c = in[i + j];
+			if (c >= '0' && c <= '9') v[j] = c - '0';
+			else if (c >= 'A' && c <= 'F') v[j] = c - 'A' + 10;
+			else if (c >= 'a' && c <= 'f') v[j] = c - 'a' + 10;
+			else return false;
+		}
+		out[i / 2] = (unsigned char)(v[0] << 4 | v[1]);
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// 㷨Կֻֽ֧AEAD㷨
+int XEnvelope::KeySize(XSecType type)
+{
+	switch (type)
+	{
+	case XAES128_GCM:
+	case XSM4_GCM:
+		return 16;
+	case XAES192_GCM:
+		return 24;
+	case XAES256_GCM:
+	case XCHACHA20_POLY1305:
+		return 32;
+	default:
+		return 0;
+	}
+}
+
+/////////////////////////////////////////////////////////////////
+/// ԿùԿ
+bool XEnvelope::WrapKey(XEccKey& key, XSecType type, std::string& pass, std::string& ek)
+{
+	//汾(1) 㷨(1) Կ
+	unsigned char plain[34] = { 0 };
+	int key_size = KeySize(type);
+	if (key_size <= 0)
+		return false;
+	plain[0] = XENVELOPE_VERSION;
+	plain[1] = (unsigned char)type;
+	if (RAND_bytes(plain + 2, key_size) != 1)
+		return false;
+	vector<unsigned char> enc;
+	bool is_ok = key.Encrypt(plain, key_size + 2, enc);
+	if (is_ok)
+	{
+		pass.assign((char*)plain + 2, key_size);
+		ek = Base16Encode(enc.data(), (int)enc.size());
+	}
+	OPENSSL_cleanse(plain, sizeof(plain));
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ˽Կekȡ㷨Կ
+bool XEnvelope::UnwrapKey(XEccKey& key, const std::string& ek, XSecType& type, std::string& pass)
+{
+	vector<unsigned char> enc;
+	if (!Base16Decode(ek, enc))
+		return false;
+	vector<unsigned char> plain;
+	if (!key.Decrypt(enc.data(), (int)enc.size(), plain))
+		return false;
+	bool is_ok = plain.size() > 2 && plain[0] == XENVELOPE_VERSION
+		&& XSec::IsAEAD((XSecType)plain[1])
+		&& (int)plain.size() == KeySize((XSecType)plain[1]) + 2;
+	if (is_ok)
+	{
+		type = (XSecType)plain[1];
+		pass.assign((char*)plain.data() + 2, plain.size() - 2);
+	}
+	OPENSSL_cleanse(plain.data(), plain.size());
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ek̳߳вд
+int XEnvelope::UnwrapKeys(XEccKey& key, const std::vector<std::string>& eks, std::vector<XEnvelopeKey>& keys)
+{
+	int count = (int)eks.size();
+	keys.clear();
+	keys.resize(count);
+	if (count == 0)
+		return 0;
+
+	//߳ҲִУ߳+1ֶΣÿڶڸ
+	auto pool = XThreadPool::Instance();
+	int task_count = pool->thread_count() + 1;
+	if (task_count > count)
+		task_count = count;
+	atomic<int> ok_count(0);
+	vector<function<void()> > tasks;
+	for (int t = 0; t < task_count; t++)
+	{
+		int begin = (int)((long long)count * t / task_count);
+		int end = (int)((long long)count * (t + 1) / task_count);
+		tasks.push_back([&, begin, end] {
+			for (int i = begin; i < end; i++)
+			{
+				XEnvelopeKey& k = keys[i];
+				k.is_ok = UnwrapKey(key, eks[i], k.type, k.pass);
+				if (k.is_ok)
+					ok_count++;
+			}
+		});
+	}
+	pool->Run(tasks);
+	return ok_count;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ڴ
+bool XEnvelope::Seal(XEccKey& key, const unsigned char* in, int in_size,
+	std::string& ek, std::vector<unsigned char>& out, XSecType type)
+{
+	if (!in || in_size <= 0)
+		return false;
+	string pass;
+	if (!WrapKey(key, type, pass, ek))
+		return false;
+	XSec sec;
+	bool is_ok = sec.Init(type, pass, true, ENVELOPE_IV);
+	OPENSSL_cleanse(&pass[0], pass.size());
+	if (!is_ok)
+		return false;
+
+	//ʱһ飬ӱǩ
+	out.resize(in_size + 32 + XSEC_TAG_SIZE);
+	int size = sec.Encrypt(in, in_size, out.data());
+	if (size <= 0 || !sec.GetTag(out.data() + size))
+		return false;
+	size += XSEC_TAG_SIZE;
+	out.resize(size);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// Seal
+bool XEnvelope::Open(XEccKey& key, const std::string& ek, const unsigned char* in, int in_size,
+	std::vector<unsigned char>& out)
+{
+	XSecType type;
+	string pass;
+	if (!in || !UnwrapKey(key, ek, type, pass))
+		return false;
+	XSec sec;
+	bool is_ok = sec.Init(type, pass, false, ENVELOPE_IV);
+	OPENSSL_cleanse(&pass[0], pass.size());
+	if (!is_ok)
+		return false;
+	if (in_size <= XSEC_TAG_SIZE)
+		return false;
+	in_size -= XSEC_TAG_SIZE;
+	if (!sec.SetTag(in + in_size))
+		return false;
+	out.resize(in_size + 32);
+	int size = sec.Encrypt(in, in_size, out.data());
+	if (size <= 0)
+	{
+		out.clear();
+		return false;
+	}
+	out.resize(size);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ļXSeekFileֿļ
+bool XEnvelope::SealFile(XEccKey& key, std::string in_filename, std::string out_filename,
+	std::string& ek, XSecType type, XCodec codec)
+{
+	string pass;
+	if (!WrapKey(key, type, pass, ek))
+		return false;
+	bool is_ok = XSeekFile::EncryptFile(in_filename, out_filename, type, pass, XSEEK_CHUNK_SIZE, codec);
+	OPENSSL_cleanse(&pass[0], pass.size());
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// SealFile
+bool XEnvelope::OpenFile(XEccKey& key, const std::string& ek, std::string in_filename, std::string out_filename)
+{
+	XSecType type;
+	string pass;
+	if (!UnwrapKey(key, ek, type, pass))
+		return false;
+
+	//ļͷ㷨Ҫekеһ£һ˵ļͷĹekļ
+	bool is_ok = false;
+	{
+		XSeekFile sf;
+		is_ok = sf.Open(in_filename, pass) && sf.type() == type;
+	}
+	if (is_ok)
+		is_ok = XSeekFile::DecryptFile(in_filename, out_filename, pass);
+	OPENSSL_cleanse(&pass[0], pass.size());
+	return is_ok;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "XSec.h"
+#include "XEcc.h"
+#include "XSeekFile.h"
+
+//ekĸʽ汾
+#define XENVELOPE_VERSION 1
+
+//UnwrapKeysһ
+struct XEnvelopeKey
+{
+	bool is_ok = false;
+	XSecType type = XAES128_GCM;
+	std::string pass;
+};
+
+/*
+ŷ⣺ÿԿXSecԳƼܣSM2ֻԿ
+ԿÿһΣݴС޹
+ekSM2ܵ 汾(1) 㷨(1) ԿBase16ıֱΪԼdataOwner_Join_ek
+ԿֻһΣԳƼܵiv̶Ϊ0
+ֻ֧AEAD㷨GCMChaCha20-Poly1305ı۸ʱʧܣOpenSSL 3.0ûSM4-GCM
+
+ôԿ
+XEccKey pub;
+pub.LoadPublicKey("pubkey.pem");
+std::string ek;
+std::vector<unsigned char> enc;
+XEnvelope::Seal(pub, data, size, ek, enc);
+XEnvelope::SealFile(pub, "data.csv", "data.csv.xscf", ek);
+
+˽Կ
+XEccKey pri;
+pri.LoadPrivateKey("private_pem");
+XEnvelope::Open(pri, ek, enc.data(), enc.size(), data);
+XEnvelope::OpenFile(pri, ek, "data.csv.xscf", "data.csv");
+
+ֻȡԿȡֿļ
+XSecType type;
+std::string pass;
+XEnvelope::UnwrapKey(pri, ek, type, pass);
+XSeekFile sf;
+sf.Open("data.csv.xscf", pass);
+
+һֽȡߵԿ
+std::vector<XEnvelopeKey> keys;
+XEnvelope::UnwrapKeys(pri, eks, keys);
+*/
+class XEnvelope
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// ڴ
+	/// @para key շԿ
+	/// @para in 
+	/// @para in_size ĴС0
+	/// @para ek ܵԿ
+	/// @para out ģXSEC_TAG_SIZEֽ֤ǩ
+	/// @para type ԳƼ㷨ֻ֧AEAD㷨
+	/// @return ɹtrueAEAD㷨false
+	static bool Seal(XEccKey& key, const unsigned char* in, int in_size,
+		std::string& ek, std::vector<unsigned char>& out, XSecType type = XAES128_GCM);
+
+	/////////////////////////////////////////////////////////////////
+	/// Seal
+	/// @para key շ˽Կ
+	/// @para ek SealļԿ
+	/// @para in 
+	/// @para in_size ĴС
+	/// @para out 
+	/// @return ˽Կԡekʽ󡢽ʧܻǩУʧܷfalse
+	static bool Open(XEccKey& key, const std::string& ek, const unsigned char* in, int in_size,
+		std::vector<unsigned char>& out);
+
+	/////////////////////////////////////////////////////////////////
+	/// ļXSeekFileֿļȡ
+	/// @para key շԿ
+	/// @para in_filename ļ
+	/// @para out_filename ļ
+	/// @para ek ܵԿ
+	/// @para type ԳƼ㷨ֻ֧AEAD㷨
+	/// @para codec ѹ㷨
+	/// @return ɹtrueAEAD㷨false
+	static bool SealFile(XEccKey& key, std::string in_filename, std::string out_filename,
+		std::string& ek, XSecType type = XAES128_GCM, XCodec codec = XCODEC_NONE);
+
+	/////////////////////////////////////////////////////////////////
+	/// SealFile
+	/// @return ɹtrueʧɾļļͷ㷨ekеĲһ·false
+	static bool OpenFile(XEccKey& key, const std::string& ek, std::string in_filename, std::string out_filename);
+
+	/////////////////////////////////////////////////////////////////
+	/// ԿùԿ
+	/// @para key շԿ
+	/// @para type ԳƼ㷨Կȣֻ֧AEAD㷨
+	/// @para pass Կ
+	/// @para ek ܵԿ
+	/// @return ɹtrueAEAD㷨false
+	static bool WrapKey(XEccKey& key, XSecType type, std::string& pass, std::string& ek);
+
+	/////////////////////////////////////////////////////////////////
+	/// ˽Կekȡ㷨Կ
+	/// @return ˽Կԡekʽ㷨AEADfalse
+	static bool UnwrapKey(XEccKey& key, const std::string& ek, XSecType& type, std::string& pass);
+
+	/////////////////////////////////////////////////////////////////
+	/// ek̳߳вд߳ʹԼģ˽Կֻһ
+	/// @para key շ˽Կ
+	/// @para eks ܵԿһֽߵek
+	/// @para keys eksһһӦʧܵis_okΪfalse
+	/// @return ɹ
+	static int UnwrapKeys(XEccKey& key, const std::vector<std::string>& eks, std::vector<XEnvelopeKey>& keys);
+
+	/////////////////////////////////////////////////////////////////
+	/// 㷨Կֽŷⲻֵ֧ķAEAD㷨0
+	static int KeySize(XSecType type);
+};
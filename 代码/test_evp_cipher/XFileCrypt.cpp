@@ -0,0 +1,942 @@
+#include "XFileCrypt.h"
+#include <openssl/rand.h>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define XFILE_URING_ENABLE
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+using namespace std;
+
+//ֽ㷨Сı
+#define XFILE_ALIGN 64
+
+//ռ䣬UpdateβFinalAEADǩ
+#define XFILE_BUF_EXTRA 128
+
+//ڴӳÿνParallelEncryptֽXFILE_ALIGN
+#define XFILE_MAP_WINDOW (256 * 1024 * 1024)
+
+//ļڴӳ䣬ӳļдȰļΪָСӳ
+class XFileMap
+{
+public:
+	~XFileMap() { Close(); }
+
+	/////////////////////////////////////////////////////////////////
+	/// ӳļ
+	/// @para is_write falseֻӳļtrueļӳsizeֽ
+	/// @return ɹtrueļfalse
+	bool Open(const string& filename, bool is_write, long long size = 0)
+	{
+		Close();
+		is_write_ = is_write;
+#ifdef _WIN32
+		file_ = CreateFileA(filename.c_str(),
+			is_write ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+			is_write ? 0 : FILE_SHARE_READ, NULL,
+			is_write ? CREATE_ALWAYS : OPEN_EXISTING,
+			FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file_ == INVALID_HANDLE_VALUE)
+			return false;
+		if (!is_write)
+		{
+			LARGE_INTEGER file_size;
+			if (!GetFileSizeEx(file_, &file_size))
+				return false;
+			size = file_size.QuadPart;
+		}
+		size_ = size;
+		if (size_ <= 0)
+			return false;
+		map_ = CreateFileMappingA(file_, NULL, is_write ? PAGE_READWRITE : PAGE_READONLY,
+			(DWORD)(size_ >> 32), (DWORD)size_, NULL);
+		if (!map_)
+			return false;
+		data_ = (unsigned char*)MapViewOfFile(map_, is_write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+		return data_ != nullptr;
+#else
+		fd_ = is_write ? open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+			: open(filename.c_str(), O_RDONLY);
+		if (fd_ < 0)
+			return false;
+		if (is_write)
+		{
+			if (ftruncate(fd_, size) != 0)
+				return false;
+		}
+		else
+		{
+			struct stat st;
+			if (fstat(fd_, &st) != 0)
+				return false;
+			size = st.st_size;
+		}
+		size_ = size;
+		if (size_ <= 0)
+			return false;
+		void* p = mmap(NULL, size_, is_write ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd_, 0);
+		if (p == MAP_FAILED)
+			return false;
+		data_ = (unsigned char*)p;
+		madvise(data_, size_, MADV_SEQUENTIAL);
+		return true;
+#endif
+	}
+
+	/////////////////////////////////////////////////////////////////
+	/// ȡӳ䲢رļ
+	/// @para new_size дӳʱļմСС0ӳС
+	/// @return дļضʧܷfalse
+	bool Close(long long new_size = -1)
+	{
+		bool re = true;
+#ifdef _WIN32
+		if (data_) UnmapViewOfFile(data_);
+		if (map_) CloseHandle(map_);
+		if (file_ != INVALID_HANDLE_VALUE)
+		{
+			if (is_write_ && new_size >= 0)
+			{
+				LARGE_INTEGER pos;
+				pos.QuadPart = new_size;
+				re = SetFilePointerEx(file_, pos, NULL, FILE_BEGIN) && SetEndOfFile(file_);
+			}
+			CloseHandle(file_);
+		}
+		map_ = NULL;
+		file_ = INVALID_HANDLE_VALUE;
+#else
+		if (data_) munmap(data_, size_);
+		if (fd_ >= 0)
+		{
+			if (is_write_ && new_size >= 0)
+				re = ftruncate(fd_, new_size) == 0;
+			close(fd_);
+		}
+		fd_ = -1;
+#endif
+		data_ = nullptr;
+		size_ = 0;
+		return re;
+	}
+
+	unsigned char* data() { return data_; }
+	long long size() { return size_; }
+
+private:
+	unsigned char* data_ = nullptr;
+	long long size_ = 0;
+	bool is_write_ = false;
+#ifdef _WIN32
+	HANDLE file_ = INVALID_HANDLE_VALUE;
+	HANDLE map_ = NULL;
+#else
+	int fd_ = -1;
+#endif
+};
+
+#ifdef XFILE_URING_ENABLE
+//O_DIRECTҪĻַļƫƺͳȶ
+#define XFILE_DIRECT_ALIGN 4096
+
+//io_uringύɶУֱʹϵͳãliburing
+class XUring
+{
+public:
+	~XUring() { Close(); }
+
+	/////////////////////////////////////////////////////////////////
+	/// вӳ䵽ûռ
+	/// @para entries ύдС
+	/// @return ں˲ֻ֧򱻽÷false
+	bool Init(unsigned entries)
+	{
+		io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		fd_ = (int)syscall(__NR_io_uring_setup, entries, &p);
+		if (fd_ < 0)
+			return false;
+		sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		bool is_single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (is_single)
+		{
+			if (cq_len_ > sq_len_) sq_len_ = cq_len_;
+			cq_len_ = sq_len_;
+		}
+		sq_ptr_ = mmap(0, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+		if (sq_ptr_ == MAP_FAILED)
+		{
+			sq_ptr_ = nullptr;
+			return false;
+		}
+		if (is_single)
+		{
+			cq_ptr_ = sq_ptr_;
+		}
+		else
+		{
+			cq_ptr_ = mmap(0, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+			if (cq_ptr_ == MAP_FAILED)
+			{
+				cq_ptr_ = nullptr;
+				return false;
+			}
+		}
+		sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+		void* sqes = mmap(0, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED)
+			return false;
+		sqes_ = (io_uring_sqe*)sqes;
+
+		char* sq = (char*)sq_ptr_;
+		sq_tail_ = (unsigned*)(sq + p.sq_off.tail);
+		sq_mask_ = *(unsigned*)(sq + p.sq_off.ring_mask);
+		sq_entries_ = p.sq_entries;
+		sq_array_ = (unsigned*)(sq + p.sq_off.array);
+		sq_head_ = (unsigned*)(sq + p.sq_off.head);
+		char* cq = (char*)cq_ptr_;
+		cq_head_ = (unsigned*)(cq + p.cq_off.head);
+		cq_tail_ = (unsigned*)(cq + p.cq_off.tail);
+		cq_mask_ = *(unsigned*)(cq + p.cq_off.ring_mask);
+		cqes_ = (io_uring_cqe*)(cq + p.cq_off.cqes);
+		return true;
+	}
+
+	void Close()
+	{
+		if (sqes_) munmap(sqes_, sqes_len_);
+		if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_len_);
+		if (sq_ptr_) munmap(sq_ptr_, sq_len_);
+		if (fd_ >= 0) close(fd_);
+		sqes_ = nullptr;
+		cq_ptr_ = sq_ptr_ = nullptr;
+		fd_ = -1;
+	}
+
+	/////////////////////////////////////////////////////////////////
+	/// һдSubmitʱһύ
+	/// @para op IORING_OP_READIORING_OP_WRITE
+	/// @para user_data ʱԭ
+	/// @return false
+	bool Prep(int op, int fd, void* buf, unsigned len, long long offset, unsigned long long user_data)
+	{
+		unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+		if (local_tail_ - head >= sq_entries_)
+			return false;
+		unsigned i = local_tail_ & sq_mask_;
+		io_uring_sqe* sqe = &sqes_[i];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = (unsigned char)op;
+		sqe->fd = fd;
+		sqe->addr = (unsigned long long)buf;
+		sqe->len = len;
+		sqe->off = offset;
+		sqe->user_data = user_data;
+		sq_array_[i] = i;
+		local_tail_++;
+		to_submit_++;
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////
+	/// ύ󣬲ȴwait_nr
+	/// @return ʧܷfalse
+	bool Submit(unsigned wait_nr)
+	{
+		__atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+		for (;;)
+		{
+			int re = (int)syscall(__NR_io_uring_enter, fd_, to_submit_, wait_nr,
+				wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+			if (re >= 0)
+			{
+				to_submit_ -= re;
+				return true;
+			}
+			if (errno != EINTR)
+				return false;
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////
+	/// ȡһ¼
+	/// @return û¼false
+	bool Peek(unsigned long long& user_data, int& res)
+	{
+		unsigned head = *cq_head_;
+		if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+			return false;
+		io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+		user_data = cqe->user_data;
+		res = cqe->res;
+		__atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+private:
+	int fd_ = -1;
+	void* sq_ptr_ = nullptr;
+	void* cq_ptr_ = nullptr;
+	size_t sq_len_ = 0;
+	size_t cq_len_ = 0;
+	size_t sqes_len_ = 0;
+	io_uring_sqe* sqes_ = nullptr;
+	io_uring_cqe* cqes_ = nullptr;
+	unsigned* sq_head_ = nullptr;
+	unsigned* sq_tail_ = nullptr;
+	unsigned* sq_array_ = nullptr;
+	unsigned sq_mask_ = 0;
+	unsigned sq_entries_ = 0;
+	unsigned* cq_head_ = nullptr;
+	unsigned* cq_tail_ = nullptr;
+	unsigned cq_mask_ = 0;
+	unsigned local_tail_ = 0;
+	unsigned to_submit_ = 0;
+};
+#endif
+
+//tڵĺ
+static double MsSince(chrono::steady_clock::time_point t)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - t).count();
+}
+
+/////////////////////////////////////////////////////////////////
+/// ʼӽܲͻ
+bool XFileCrypt::Init(XSecType type, std::string pass, bool is_en, int buf_size, int buf_count)
+{
+	if (!sec_.Init(type, pass, is_en))
+		return false;
+	is_en_ = is_en;
+	is_aead_ = XSec::IsAEAD(type);
+	iv_size_ = sec_.iv_size();
+	if (iv_size_ > (int)sizeof(iv_))
+		return false;
+
+	buf_size = buf_size / XFILE_ALIGN * XFILE_ALIGN;
+	if (buf_size < XFILE_ALIGN)
+		buf_size = XFILE_ALIGN;
+	if (buf_count < 2)
+		buf_count = 2;
+	buf_size_ = buf_size;
+	bufs_.clear();
+	bufs_.resize(buf_count);
+	for (auto& b : bufs_)
+		b.data.resize(buf_size + XFILE_BUF_EXTRA);
+	return true;
+}
+
+//ȴָ״̬false
+bool XFileCrypt::Wait(Buf& buf, BufState state)
+{
+	unique_lock<mutex> lock(mux_);
+	cv_.wait(lock, [&] { return is_error_ || buf.state == state; });
+	return !is_error_;
+}
+
+//û״̬֪ͨ׶
+void XFileCrypt::Set(Buf& buf, BufState state)
+{
+	{
+		unique_lock<mutex> lock(mux_);
+		buf.state = state;
+	}
+	cv_.notify_all();
+}
+
+//֪ͨн׶˳
+void XFileCrypt::Fail()
+{
+	{
+		unique_lock<mutex> lock(mux_);
+		is_error_ = true;
+	}
+	cv_.notify_all();
+}
+
+//ʼһļʱivʱiv_Ѵļͷiv_XSec
+bool XFileCrypt::ResetIV()
+{
+	if (iv_size_ == 0)
+		return sec_.Reset();
+	if (is_en_ && RAND_bytes(iv_, iv_size_) != 1)
+		return false;
+	return sec_.Reset(iv_);
+}
+
+/////////////////////////////////////////////////////////////////
+/// ӽļļдļһ̣߳ӽڵ߳
+/// 鰴˳ת߳һ齻ӽܣӽɽд̣߳
+/// дٻ̣߳ӽܡдͬʱͬĿ
+bool XFileCrypt::Encrypt(std::string in_filename, std::string out_filename)
+{
+	if (bufs_.empty())
+		return false;
+	auto start = chrono::steady_clock::now();
+	in_size_ = 0;
+	out_size_ = 0;
+	read_ms_ = cipher_ms_ = write_ms_ = total_ms_ = 0;
+	is_error_ = false;
+	for (auto& b : bufs_)
+	{
+		b.size = 0;
+		b.is_end = false;
+		b.state = BUF_FREE;
+	}
+
+	ifstream ifs(in_filename, ios::binary);
+	if (!ifs) return false;
+	ofstream ofs(out_filename, ios::binary);
+	if (!ofs)
+	{
+		ifs.close();
+		return false;
+	}
+
+	//ʱivдļͷʱȶiv
+	if (!is_en_ && iv_size_ > 0)
+	{
+		ifs.read((char*)iv_, iv_size_);
+		in_size_ = ifs.gcount();
+	}
+	bool is_ok = in_size_ == (is_en_ ? 0 : iv_size_) && ResetIV();
+	if (is_ok && is_en_ && iv_size_ > 0)
+	{
+		ofs.write((char*)iv_, iv_size_);
+		is_ok = (bool)ofs;
+		out_size_ = iv_size_;
+	}
+
+	//AEADܣǩļĩβ
+	long long remain = -1;
+	if (is_ok && is_aead_ && !is_en_)
+	{
+		ifs.seekg(0, ios::end);
+		long long file_size = ifs.tellg();
+		unsigned char tag[XSEC_TAG_SIZE] = { 0 };
+		is_ok = file_size >= iv_size_ + XSEC_TAG_SIZE;
+		if (is_ok)
+		{
+			ifs.seekg(file_size - XSEC_TAG_SIZE);
+			ifs.read((char*)tag, XSEC_TAG_SIZE);
+			ifs.seekg(iv_size_);
+			is_ok = ifs && sec_.SetTag(tag);
+			remain = file_size - iv_size_ - XSEC_TAG_SIZE;
+			in_size_ += XSEC_TAG_SIZE;
+		}
+	}
+	if (!is_ok)
+	{
+		ifs.close();
+		ofs.close();
+		remove(out_filename.c_str());
+		return false;
+	}
+
+	int count = (int)bufs_.size();
+
+	//߳
+	thread reader([&] {
+		for (int i = 0;; i = (i + 1) % count)
+		{
+			Buf& b = bufs_[i];
+			if (!Wait(b, BUF_FREE)) return;
+			int want = buf_size_;
+			if (remain >= 0 && remain < want)
+				want = (int)remain;
+			auto t = chrono::steady_clock::now();
+			ifs.read((char*)b.data.data(), want);
+			read_ms_ += MsSince(t);
+			if (ifs.bad())
+			{
+				Fail();
+				return;
+			}
+			b.size = (int)ifs.gcount();
+			if (remain >= 0)
+				remain -= b.size;
+			in_size_ += b.size;
+
+			//ļСǻʱ0ֽڵĿҲҪFinal
+			b.is_end = b.size < want || remain == 0;
+			bool is_end = b.is_end;
+			Set(b, BUF_READ);
+			if (is_end) return;
+		}
+	});
+
+	//д߳
+	thread writer([&] {
+		for (int i = 0;; i = (i + 1) % count)
+		{
+			Buf& b = bufs_[i];
+			if (!Wait(b, BUF_DONE)) return;
+			auto t = chrono::steady_clock::now();
+			if (b.size > 0)
+				ofs.write((char*)b.data.data(), b.size);
+			write_ms_ += MsSince(t);
+			if (!ofs)
+			{
+				Fail();
+				return;
+			}
+			out_size_ += b.size;
+			bool is_end = b.is_end;
+			Set(b, BUF_FREE);
+			if (is_end) return;
+		}
+	});
+
+	//ӽܣԭش
+	for (int i = 0;; i = (i + 1) % count)
+	{
+		Buf& b = bufs_[i];
+		if (!Wait(b, BUF_READ)) break;
+		auto t = chrono::steady_clock::now();
+		unsigned char* data = b.data.data();
+		int len = sec_.Update(data, b.size, data);
+		if (len < 0)
+		{
+			Fail();
+			break;
+		}
+		if (b.is_end)
+		{
+			int re = sec_.Final(data + len);
+			if (re < 0)
+			{
+				Fail();
+				break;
+			}
+			len += re;
+			if (is_aead_ && is_en_)
+			{
+				sec_.GetTag(data + len);
+				len += XSEC_TAG_SIZE;
+			}
+		}
+		b.size = len;
+		cipher_ms_ += MsSince(t);
+		bool is_end = b.is_end;
+		Set(b, BUF_DONE);
+		if (is_end) break;
+	}
+	reader.join();
+	writer.join();
+	ifs.close();
+	ofs.close();
+	total_ms_ = MsSince(start);
+
+	//ʧʱ²δͨУ
+	if (is_error_)
+	{
+		remove(out_filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ڴӳ䷽ʽӽļ
+/// ļȰܴС++ǩɺضϵʵʴС
+/// һڲСXFILE_MAP_WINDOWļСʱļʱֻʣ
+bool XFileCrypt::EncryptMap(std::string in_filename, std::string out_filename)
+{
+	auto start = chrono::steady_clock::now();
+	in_size_ = 0;
+	out_size_ = 0;
+	read_ms_ = cipher_ms_ = write_ms_ = total_ms_ = 0;
+	XFileMap in_map;
+	bool is_map = in_map.Open(in_filename, false);
+	read_ms_ = MsSince(start);
+	if (!is_map)
+	{
+		//ļӳ
+		if (in_map.size() == 0)
+		{
+			in_map.Close();
+			return Encrypt(in_filename, out_filename);
+		}
+		return false;
+	}
+	if (in_map.size() <= XFILE_ALIGN)
+	{
+		in_map.Close();
+		return Encrypt(in_filename, out_filename);
+	}
+
+	//ļͷivʽEncryptͬXFILE_ALIGNļһivͱǩ
+	const unsigned char* in = in_map.data();
+	long long in_size = in_map.size();
+	if (!is_en_ && iv_size_ > 0)
+	{
+		memcpy(iv_, in, iv_size_);
+		in += iv_size_;
+		in_size -= iv_size_;
+	}
+	bool is_ok = ResetIV();
+
+	//AEADܣǩļĩβ
+	if (is_ok && is_aead_ && !is_en_)
+	{
+		in_size -= XSEC_TAG_SIZE;
+		is_ok = sec_.SetTag(in + in_size);
+	}
+	if (!is_ok)
+		return false;
+	long long out_max = in_size + iv_size_ + XFILE_BUF_EXTRA;
+	XFileMap out_map;
+	if (!out_map.Open(out_filename, true, out_max))
+	{
+		out_map.Close();
+		remove(out_filename.c_str());
+		return false;
+	}
+	unsigned char* out = out_map.data();
+
+	long long pos = 0;
+	long long out_pos = 0;
+	if (is_en_ && iv_size_ > 0)
+	{
+		memcpy(out, iv_, iv_size_);
+		out_pos = iv_size_;
+	}
+	auto t = chrono::steady_clock::now();
+	while (is_ok)
+	{
+		long long left = in_size - pos;
+		bool is_end = left < 2LL * XFILE_MAP_WINDOW;
+		int size = is_end ? (int)left : XFILE_MAP_WINDOW;
+		int len = sec_.ParallelEncrypt(in + pos, size, out + out_pos, is_end);
+		if (len <= 0)
+		{
+			is_ok = false;
+			break;
+		}
+		pos += size;
+		out_pos += len;
+		if (is_end) break;
+	}
+	if (is_ok && is_aead_ && is_en_)
+	{
+		sec_.GetTag(out + out_pos);
+		out_pos += XSEC_TAG_SIZE;
+	}
+
+	cipher_ms_ = MsSince(t);
+
+	in_size_ = in_map.size();
+	in_map.Close();
+	t = chrono::steady_clock::now();
+	bool is_close = out_map.Close(is_ok ? out_pos : 0);
+	write_ms_ = MsSince(t);
+	total_ms_ = MsSince(start);
+	if (!is_close || !is_ok)
+	{
+		remove(out_filename.c_str());
+		return false;
+	}
+	out_size_ = out_pos;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// io_uring첽дӽļ
+/// 鰴˳ʹãпύ󣬶갴˳ӽܺύддٶ
+/// дһύһio_uring_enterȴһ
+bool XFileCrypt::EncryptUring(std::string in_filename, std::string out_filename, bool is_direct)
+{
+#ifndef XFILE_URING_ENABLE
+	return Encrypt(in_filename, out_filename);
+#else
+	if (bufs_.empty())
+		return false;
+	auto start = chrono::steady_clock::now();
+	read_ms_ = cipher_ms_ = write_ms_ = total_ms_ = 0;
+	int count = (int)bufs_.size();
+	XUring ring;
+	unsigned entries = 1;
+	while (entries < (unsigned)count * 2) entries <<= 1;
+	if (!ring.Init(entries))
+		return Encrypt(in_filename, out_filename);
+
+	int in_fd = -1;
+	if (is_direct)
+		in_fd = open(in_filename.c_str(), O_RDONLY | O_DIRECT);
+	if (in_fd < 0)
+	{
+		is_direct = false;
+		in_fd = open(in_filename.c_str(), O_RDONLY);
+	}
+	if (in_fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(in_fd, &st) != 0)
+	{
+		close(in_fd);
+		return false;
+	}
+	//ûʱûжд󣬰Encrypt
+	long long data_size = st.st_size;
+	if (data_size == 0 || (!is_en_ && data_size <= iv_size_ + (is_aead_ ? XSEC_TAG_SIZE : 0)))
+	{
+		close(in_fd);
+		return Encrypt(in_filename, out_filename);
+	}
+	int out_fd = open(out_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out_fd < 0)
+	{
+		close(in_fd);
+		return false;
+	}
+	in_size_ = data_size;
+	out_size_ = 0;
+
+	//ʱȶļͷivAEADģʽĩβıǩ
+	//O_DIRECTҪƫƶ룬ͨʽ򿪶ȡԴƫ0𣬵һiv
+	bool is_ok = true;
+	unsigned char tag[XSEC_TAG_SIZE] = { 0 };
+	if (!is_en_)
+	{
+		int head_fd = is_direct ? open(in_filename.c_str(), O_RDONLY) : in_fd;
+		if (head_fd < 0 || pread(head_fd, iv_, iv_size_, 0) != iv_size_)
+			is_ok = false;
+		if (is_ok && is_aead_)
+		{
+			data_size -= XSEC_TAG_SIZE;
+			if (pread(head_fd, tag, XSEC_TAG_SIZE, data_size) != XSEC_TAG_SIZE)
+				is_ok = false;
+		}
+		if (head_fd >= 0 && head_fd != in_fd)
+			close(head_fd);
+	}
+	is_ok = is_ok && ResetIV();
+	if (is_ok && is_aead_ && !is_en_)
+		is_ok = sec_.SetTag(tag);
+
+	//ʱivдļͷݴiv֮д
+	if (is_ok && is_en_ && iv_size_ > 0 && pwrite(out_fd, iv_, iv_size_, 0) != iv_size_)
+		is_ok = false;
+
+	//O_DIRECT󳤶Ȱ4K룬С͵ַҲ
+	int buf_size = buf_size_;
+	if (is_direct)
+		buf_size = (buf_size + XFILE_DIRECT_ALIGN - 1) / XFILE_DIRECT_ALIGN * XFILE_DIRECT_ALIGN;
+	//ÿ4K룬֤ÿʼַ
+	int buf_cap = (buf_size + XFILE_BUF_EXTRA + XFILE_DIRECT_ALIGN - 1) / XFILE_DIRECT_ALIGN * XFILE_DIRECT_ALIGN;
+	vector<unsigned char> mem((size_t)buf_cap * count + XFILE_DIRECT_ALIGN);
+	unsigned char* base = mem.data() + (XFILE_DIRECT_ALIGN - (size_t)mem.data() % XFILE_DIRECT_ALIGN) % XFILE_DIRECT_ALIGN;
+
+	enum { SLOT_FREE, SLOT_READING, SLOT_READ, SLOT_WRITING };
+	struct Slot
+	{
+		unsigned char* data = nullptr;
+		int state = SLOT_FREE;
+		long long offset = 0;	//ļƫƣдļʱƫ
+		int want = 0;			//Ҫдֽ
+		int done = 0;			//ɵֽ
+		int submit = 0;			//ִеӵڼֽڿʼ
+		bool is_end = false;
+	};
+	vector<Slot> slots(count);
+	for (int i = 0; i < count; i++)
+		slots[i].data = base + (size_t)buf_cap * i;
+
+	//ύдO_DIRECT϶룬ļĩβ᷵ʵֽ
+	//O_DIRECTʱɲ¶λض֤ƫƺ͵ַ
+	auto prep_read = [&](int i) {
+		Slot& s = slots[i];
+		s.submit = s.done;
+		if (is_direct)
+			s.submit = s.done / XFILE_DIRECT_ALIGN * XFILE_DIRECT_ALIGN;
+		unsigned len = s.want - s.submit;
+		if (is_direct)
+			len = (len + XFILE_DIRECT_ALIGN - 1) / XFILE_DIRECT_ALIGN * XFILE_DIRECT_ALIGN;
+		return ring.Prep(IORING_OP_READ, in_fd, s.data + s.submit, len, s.offset + s.submit, i);
+	};
+	auto prep_write = [&](int i) {
+		Slot& s = slots[i];
+		s.submit = s.done;
+		return ring.Prep(IORING_OP_WRITE, out_fd, s.data + s.done, s.want - s.done, s.offset + s.done, i);
+	};
+
+	long long read_offset = 0;
+	long long out_offset = is_en_ ? iv_size_ : 0;
+	int read_index = 0;		//һύĿ
+	int crypt_index = 0;	//һӽܵĿ
+	int inflight = 0;		//ύδɵ
+	bool is_crypt_end = false;
+	while (is_ok)
+	{
+		//пȫύ
+		while (read_offset < data_size && slots[read_index].state == SLOT_FREE)
+		{
+			Slot& s = slots[read_index];
+			s.offset = read_offset;
+			s.want = (int)(data_size - read_offset < buf_size ? data_size - read_offset : buf_size);
+			s.done = 0;
+			read_offset += s.want;
+			s.is_end = read_offset >= data_size;
+			if (!prep_read(read_index)) { is_ok = false; break; }
+			s.state = SLOT_READING;
+			inflight++;
+			read_index = (read_index + 1) % count;
+		}
+
+		//˳ӽѶĿ飬ԭشύд
+		auto t = chrono::steady_clock::now();
+		while (is_ok && slots[crypt_index].state == SLOT_READ)
+		{
+			Slot& s = slots[crypt_index];
+
+			//ʱһ鿪ͷivƵ鿪ͷ
+			int skip = (!is_en_ && s.offset == 0) ? iv_size_ : 0;
+			unsigned char* p = s.data + skip;
+			int len = sec_.Update(p, s.want - skip, p);
+			if (len >= 0 && s.is_end)
+			{
+				int re = sec_.Final(p + len);
+				if (re < 0)
+				{
+					len = -1;
+				}
+				else
+				{
+					len += re;
+					if (is_aead_ && is_en_)
+					{
+						sec_.GetTag(p + len);
+						len += XSEC_TAG_SIZE;
+					}
+				}
+			}
+			if (len < 0) { is_ok = false; break; }
+			if (skip > 0 && len > 0)
+				memmove(s.data, p, len);
+			if (s.is_end) is_crypt_end = true;
+			s.offset = out_offset;
+			s.want = len;
+			s.done = 0;
+			out_offset += len;
+			if (len == 0)
+			{
+				s.state = SLOT_FREE;
+			}
+			else
+			{
+				if (!prep_write(crypt_index)) { is_ok = false; break; }
+				s.state = SLOT_WRITING;
+				inflight++;
+			}
+			crypt_index = (crypt_index + 1) % count;
+		}
+		cipher_ms_ += MsSince(t);
+		if (!is_ok || (is_crypt_end && inflight == 0))
+			break;
+
+		//ύȴһɣһҪӽܵĿ黹ûȴдȴ
+		t = chrono::steady_clock::now();
+		bool is_read_wait = !is_crypt_end && slots[crypt_index].state == SLOT_READING;
+		if (!ring.Submit(1)) { is_ok = false; break; }
+		if (is_read_wait)
+			read_ms_ += MsSince(t);
+		else
+			write_ms_ += MsSince(t);
+		unsigned long long user_data = 0;
+		int res = 0;
+		while (ring.Peek(user_data, res))
+		{
+			inflight--;
+			Slot& s = slots[(int)user_data];
+			//ûݣļضϣʧܴظύ
+			if (res <= 0 || s.submit + res <= s.done)
+			{
+				is_ok = false;
+				continue;
+			}
+			s.done = s.submit + res;
+			if (s.done > s.want)
+				s.done = s.want;
+			if (s.done < s.want)
+			{
+				//дύʣಿ
+				bool re = s.state == SLOT_READING ? prep_read((int)user_data) : prep_write((int)user_data);
+				if (!re) is_ok = false;
+				else inflight++;
+				continue;
+			}
+			s.state = s.state == SLOT_READING ? SLOT_READ : SLOT_FREE;
+		}
+	}
+
+	//ʱȴύɣͷ
+	while (!is_ok && inflight > 0 && ring.Submit(1))
+	{
+		unsigned long long user_data = 0;
+		int res = 0;
+		while (ring.Peek(user_data, res))
+			inflight--;
+	}
+	ring.Close();
+	close(in_fd);
+	if (close(out_fd) != 0)
+		is_ok = false;
+	total_ms_ = MsSince(start);
+	if (!is_ok)
+	{
+		remove(out_filename.c_str());
+		return false;
+	}
+	out_size_ = out_offset;
+	return true;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////
+/// ϴμӽܵͳ
+XFileStat XFileCrypt::stat()
+{
+	XFileStat st;
+	st.in_size = in_size_;
+	st.out_size = out_size_;
+	st.read_ms = read_ms_;
+	st.cipher_ms = cipher_ms_;
+	st.write_ms = write_ms_;
+	st.total_ms = total_ms_;
+	if (total_ms_ > 0)
+		st.mbps = in_size_ / (1024.0 * 1024.0) / (total_ms_ / 1000.0);
+	return st;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ָʽӽļ
+bool XFileCrypt::Encrypt(std::string in_filename, std::string out_filename, XFileBackend backend, bool is_direct)
+{
+	switch (backend)
+	{
+	case XFILE_MAP:
+		return EncryptMap(in_filename, out_filename);
+	case XFILE_URING:
+		return EncryptUring(in_filename, out_filename, is_direct);
+	default:
+		return Encrypt(in_filename, out_filename);
+	}
+}
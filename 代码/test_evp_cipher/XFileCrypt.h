@@ -0,0 +1,164 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include "XSec.h"
+
+//ĬϻС
+#define XFILE_BUF_SIZE (4 * 1024 * 1024)
+#define XFILE_BUF_COUNT 4
+
+//ļӽܷʽ
+enum XFileBackend
+{
+	XFILE_PIPELINE,		//ӽܡд߳ˮ
+	XFILE_MAP,			//ڴӳ
+	XFILE_URING			//Linux io_uring첽дƽ̨ͬXFILE_PIPELINE
+};
+
+//һļӽܵͳ
+struct XFileStat
+{
+	long long in_size = 0;
+	long long out_size = 0;
+
+	//׶κʱ
+	//ˮߺio_uringĶӽܡдͬʱУϼƴtotal_msӽtotal_msĽ׶ƿ
+	//io_uringread_ms write_msǼӽܵȴɡȴдɵʱ
+	//ڴӳȱҳcipher_msread_msӳʱ䣬write_msǽضϺͽӳʱ
+	double read_ms = 0;
+	double cipher_ms = 0;
+	double write_ms = 0;
+	double total_ms = 0;
+
+	//ȡݵMB/s
+	double mbps = 0;
+};
+
+/*
+ļʽiv +  + AEADǩ(XSEC_TAG_SIZE)
+ivÿμRAND_bytesɣֽXSec::iv_size()ECBûiv
+ͬһԿܶļʱivͬCTRAEADģʽظʹԿ
+XFileCrypt fc;
+fc.Init(XAES128_CBC, "1234567812345678", true);
+fc.Encrypt("data.csv", "data.csv.enc");
+*/
+class XFileCrypt
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// ʼӽܲͻ
+	/// @para type 㷨
+	/// @para pass Կ
+	/// @para is_en ܻǽ
+	/// @para buf_size ÿ黺ĴСС
+	/// @para buf_count 2飬ӽܡдռһʱͬʱ
+	/// @return ɹtrue
+	bool Init(XSecType type, std::string pass, bool is_en,
+		int buf_size = XFILE_BUF_SIZE, int buf_count = XFILE_BUF_COUNT);
+
+	/////////////////////////////////////////////////////////////////
+	/// ӽļļдļһ̣߳ӽڵ߳
+	/// ʱivдļͷʱļͷ
+	/// AEADģʽʱǩдļĩβʱȶǩٽ
+	/// @para in_filename ļ
+	/// @para out_filename ļ
+	/// @return ɹtrueдʧܡʧܻǩУʧܷfalse
+	bool Encrypt(std::string in_filename, std::string out_filename);
+
+	/////////////////////////////////////////////////////////////////
+	/// ڴӳ䷽ʽӽļļԤȷСļӳ䵽ڴ棬
+	/// ֱӴӳӽܵӳ䣬ûм仺ĸ
+	/// ڵParallelEncryptECBCTRCBC̴ܶ߳
+	/// ʽEncryptͬivļͷԻ
+	/// Сļ64ֽڣûӳıҪEncrypt
+	/// @para in_filename ļ
+	/// @para out_filename ļ
+	/// @return ɹtrueʧܷfalseɾļ
+	bool EncryptMap(std::string in_filename, std::string out_filename);
+
+	/////////////////////////////////////////////////////////////////
+	/// io_uring첽дӽļлĶдύںˣ
+	/// ֻ߳ӽܣļд
+	/// ʽEncryptͬʱivͨʽO_DIRECTԴƫ0ȡ
+	/// Linuxƽ̨ں˲֧io_uringʱEncrypt
+	/// @para in_filename ļ
+	/// @para out_filename ļ
+	/// @para is_direct ļʹO_DIRECTƹҳ棬ļϵͳ֧ʱԶر
+	///		  ݳȲ4K룬ļʹO_DIRECT
+	/// @return ɹtrueʧܷfalseɾļ
+	bool EncryptUring(std::string in_filename, std::string out_filename, bool is_direct = false);
+
+	/////////////////////////////////////////////////////////////////
+	/// ָʽӽļ
+	/// @para is_direct ֻXFILE_URINGЧEncryptUring
+	bool Encrypt(std::string in_filename, std::string out_filename, XFileBackend backend, bool is_direct = false);
+
+	/////////////////////////////////////////////////////////////////
+	/// ͷŻ壬ٴμӽǰҪInit
+	void Clear() { bufs_.clear(); bufs_.shrink_to_fit(); }
+
+	//ϴμӽܶȡֽ
+	long long in_size() { return in_size_; }
+
+	//ϴμӽдֽ
+	long long out_size() { return out_size_; }
+
+	//ϴμӽܵͳ
+	XFileStat stat();
+
+	//ϴμӽܵivʱɣʱļͷECBΪ
+	std::string iv() { return std::string((char*)iv_, iv_size_); }
+
+private:
+	//״̬˳׶μת
+	enum BufState
+	{
+		BUF_FREE,	//Уȴ
+		BUF_READ,	//Ѷ룬ȴӽ
+		BUF_DONE	//Ѽӽܣȴд
+	};
+	struct Buf
+	{
+		std::vector<unsigned char> data;
+		int size = 0;
+		bool is_end = false;
+		BufState state = BUF_FREE;
+	};
+
+	//ȴָ״̬false
+	bool Wait(Buf& buf, BufState state);
+
+	//û״̬֪ͨ׶
+	void Set(Buf& buf, BufState state);
+
+	//֪ͨн׶˳
+	void Fail();
+
+	//ʼһļʱivʱiv_Ѵļͷiv_XSec
+	bool ResetIV();
+
+	XSec sec_;
+
+	//μӽܵiviv_size_Ϊ0ʱûiv
+	unsigned char iv_[16] = { 0 };
+	int iv_size_ = 0;
+	bool is_en_ = true;
+	bool is_aead_ = false;
+	int buf_size_ = XFILE_BUF_SIZE;
+	std::vector<Buf> bufs_;
+
+	std::mutex mux_;
+	std::condition_variable cv_;
+	bool is_error_ = false;
+
+	long long in_size_ = 0;
+	long long out_size_ = 0;
+
+	//ϴμӽܸ׶κʱ
+	double read_ms_ = 0;
+	double cipher_ms_ = 0;
+	double write_ms_ = 0;
+	double total_ms_ = 0;
+};
@@ -0,0 +1,184 @@
+#include "XFileMetrics.h"
+#include "XBench.h"
+#include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <cstdio>
+using namespace std;
+
+//ʱֲϽ磬
+static const double XFILE_METRICS_BUCKETS[] = { 0.01, 0.1, 1, 10, 60, 600 };
+static const int XFILE_METRICS_BUCKET_COUNT = sizeof(XFILE_METRICS_BUCKETS) / sizeof(double);
+
+static const char* BackendName(XFileBackend backend)
+{
+	switch (backend)
+	{
+	case XFILE_MAP: return "map";
+	case XFILE_URING: return "uring";
+	default: return "pipeline";
+	}
+}
+
+//JSONַת壬Windows·зб
+static string Escape(const string& str)
+{
+	string re;
+	for (unsigned char c : str)
+	{
+		if (c == '"' || c == '\\')
+		{
+			re += '\\';
+			re += c;
+		}
+		else if (c < 0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			re += buf;
+		}
+		else
+		{
+			re += c;
+		}
+	}
+	return re;
+}
+
+//תʮ
+static string Hex(const string& data)
+{
+	static const char* digits = "0123456789abcdef";
+	string re;
+	for (unsigned char c : data)
+	{
+		re += digits[c >> 4];
+		re += digits[c & 0x0f];
+	}
+	return re;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ¼һ
+void XFileMetrics::Add(const XFileJob& job, const XFileJobResult& re)
+{
+	unique_lock<mutex> lock(mux_);
+	if (re.is_ok)
+		jobs_ok_++;
+	else
+		jobs_failed_++;
+	bytes_in_ += re.in_size;
+	bytes_out_ += re.out_size;
+	wait_s_ += re.wait_ms / 1000;
+	read_s_ += re.read_ms / 1000;
+	cipher_s_ += re.cipher_ms / 1000;
+	write_s_ += re.write_ms / 1000;
+	total_s_ += re.ms / 1000;
+
+	if (buckets_.empty())
+		buckets_.resize(XFILE_METRICS_BUCKET_COUNT + 1);
+	int i = 0;
+	while (i < XFILE_METRICS_BUCKET_COUNT && re.ms / 1000 > XFILE_METRICS_BUCKETS[i])
+		i++;
+	buckets_[i]++;
+
+	if (json_)
+		*json_ << ToJSON(job, re) << endl;
+}
+
+/////////////////////////////////////////////////////////////////
+/// XFileServiceĻص
+XFileService::Callback XFileMetrics::Callback(XFileService::Callback next)
+{
+	return [this, next](const XFileJob& job, const XFileJobResult& re) {
+		Add(job, re);
+		if (next)
+			next(job, re);
+	};
+}
+
+/////////////////////////////////////////////////////////////////
+/// ÿʱһJSON
+void XFileMetrics::SetJSONLog(std::ostream* os)
+{
+	unique_lock<mutex> lock(mux_);
+	json_ = os;
+}
+
+/////////////////////////////////////////////////////////////////
+/// һָ꣬һJSON
+std::string XFileMetrics::ToJSON(const XFileJob& job, const XFileJobResult& re)
+{
+	stringstream ss;
+	ss << fixed << setprecision(3);
+	ss << "{\"id\":" << re.id << ",\"ok\":" << (re.is_ok ? "true" : "false")
+		<< ",\"in_file\":\"" << Escape(job.in_filename) << "\",\"out_file\":\"" << Escape(job.out_filename) << "\""
+		<< ",\"type\":\"" << XBench::TypeName(job.type) << "\""
+		<< ",\"direction\":\"" << (job.is_en ? "encrypt" : "decrypt") << "\""
+		<< ",\"backend\":\"" << BackendName(job.backend) << "\""
+		<< ",\"in_size\":" << re.in_size << ",\"out_size\":" << re.out_size
+		<< ",\"wait_ms\":" << re.wait_ms << ",\"read_ms\":" << re.read_ms
+		<< ",\"cipher_ms\":" << re.cipher_ms << ",\"write_ms\":" << re.write_ms
+		<< ",\"ms\":" << re.ms << ",\"mb_s\":" << re.mbps
+		<< ",\"thread\":" << re.thread_index
+		<< ",\"iv\":\"" << Hex(re.iv) << "\"}";
+	return ss.str();
+}
+
+/////////////////////////////////////////////////////////////////
+/// ۼƵָ꣬Prometheusıʽ
+std::string XFileMetrics::ToPrometheus()
+{
+	unique_lock<mutex> lock(mux_);
+	stringstream ss;
+	ss << setprecision(9);
+	ss << "# HELP xfile_jobs_total File encryption jobs finished.\n"
+		<< "# TYPE xfile_jobs_total counter\n"
+		<< "xfile_jobs_total{result=\"ok\"} " << jobs_ok_ << "\n"
+		<< "xfile_jobs_total{result=\"failed\"} " << jobs_failed_ << "\n";
+	ss << "# HELP xfile_bytes_total Bytes read and written by file encryption jobs.\n"
+		<< "# TYPE xfile_bytes_total counter\n"
+		<< "xfile_bytes_total{direction=\"in\"} " << bytes_in_ << "\n"
+		<< "xfile_bytes_total{direction=\"out\"} " << bytes_out_ << "\n";
+	ss << "# HELP xfile_stage_seconds_total Time spent per stage; read, cipher and write overlap.\n"
+		<< "# TYPE xfile_stage_seconds_total counter\n"
+		<< "xfile_stage_seconds_total{stage=\"wait\"} " << wait_s_ << "\n"
+		<< "xfile_stage_seconds_total{stage=\"read\"} " << read_s_ << "\n"
+		<< "xfile_stage_seconds_total{stage=\"cipher\"} " << cipher_s_ << "\n"
+		<< "xfile_stage_seconds_total{stage=\"write\"} " << write_s_ << "\n";
+	ss << "# HELP xfile_job_duration_seconds Job duration excluding queue wait.\n"
+		<< "# TYPE xfile_job_duration_seconds histogram\n";
+	long long count = 0;
+	for (int i = 0; i <= XFILE_METRICS_BUCKET_COUNT; i++)
+	{
+		if (i < (int)buckets_.size())
+			count += buckets_[i];
+		ss << "xfile_job_duration_seconds_bucket{le=\"";
+		if (i < XFILE_METRICS_BUCKET_COUNT)
+			ss << XFILE_METRICS_BUCKETS[i];
+		else
+			ss << "+Inf";
+		ss << "\"} " << count << "\n";
+	}
+	ss << "xfile_job_duration_seconds_sum " << total_s_ << "\n"
+		<< "xfile_job_duration_seconds_count " << count << "\n";
+	return ss.str();
+}
+
+/////////////////////////////////////////////////////////////////
+/// дPrometheusıļдʱļٸ
+bool XFileMetrics::WritePrometheus(std::string filename)
+{
+	string tmp = filename + ".tmp";
+	{
+		ofstream ofs(tmp, ios::binary);
+		ofs << ToPrometheus();
+		if (!ofs)
+			return false;
+	}
+	//Windowsrenameܸļƽֱ̨Ӹǣļڵļ϶
+#ifdef _WIN32
+	remove(filename.c_str());
+#endif
+	return rename(tmp.c_str(), filename.c_str()) == 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <iosfwd>
+#include "XFileService.h"
+
+/*
+XFileMetrics metrics;
+ofstream json("xfile_jobs.json");
+metrics.SetJSONLog(&json);			//ÿһJSON
+XFileService fs;
+fs.SetCallback(metrics.Callback());
+...
+metrics.WritePrometheus("xfile.prom");	//node_exporter textfileɼ
+*/
+class XFileMetrics
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// ¼һ񣬶߳̿ͬʱ
+	void Add(const XFileJob& job, const XFileJobResult& re);
+
+	/////////////////////////////////////////////////////////////////
+	/// XFileServiceĻصȼ¼ٵnext
+	/// @para next ԭĻصΪ
+	XFileService::Callback Callback(XFileService::Callback next = nullptr);
+
+	/////////////////////////////////////////////////////////////////
+	/// ÿʱһJSON
+	/// @para os NULLXFileMetricsʹڼ䲻ͷ
+	void SetJSONLog(std::ostream* os);
+
+	/////////////////////////////////////////////////////////////////
+	/// ۼƵָ꣬Prometheusıʽ
+	/// ֽ׶ۼʱֲֽ
+	std::string ToPrometheus();
+
+	/////////////////////////////////////////////////////////////////
+	/// дPrometheusıļдʱļٸɼʱһ
+	/// @return дʧܷfalse
+	bool WritePrometheus(std::string filename);
+
+	/////////////////////////////////////////////////////////////////
+	/// һָ꣬һJSON
+	static std::string ToJSON(const XFileJob& job, const XFileJobResult& re);
+
+private:
+	std::mutex mux_;
+	std::ostream* json_ = nullptr;
+
+	long long jobs_ok_ = 0;
+	long long jobs_failed_ = 0;
+	long long bytes_in_ = 0;
+	long long bytes_out_ = 0;
+
+	//׶ۼ
+	double wait_s_ = 0;
+	double read_s_ = 0;
+	double cipher_s_ = 0;
+	double write_s_ = 0;
+	double total_s_ = 0;
+
+	//ʱֲXFILE_METRICS_BUCKETSӦһ+Inf
+	std::vector<long long> buckets_;
+};
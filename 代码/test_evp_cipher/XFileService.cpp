@@ -0,0 +1,215 @@
+#include "XFileService.h"
+#include <sys/stat.h>
+using namespace std;
+
+//Сļ尴˶
+#define XFILE_SERVICE_ALIGN 4096
+
+/////////////////////////////////////////////////////////////////
+/// ̣߳ÿ߳һXFileCryptԿ߳ڸ
+void XFileService::Start(int thread_count, long long mem_budget, int buf_size, int buf_count)
+{
+	Stop();
+	if (thread_count <= 0)
+		thread_count = thread::hardware_concurrency();
+	if (thread_count <= 0)
+		thread_count = 1;
+	if (buf_size < XFILE_SERVICE_ALIGN)
+		buf_size = XFILE_SERVICE_ALIGN;
+	if (buf_count < 2)
+		buf_count = 2;
+	buf_size_ = buf_size;
+	buf_count_ = buf_count;
+	mem_budget_ = mem_budget;
+	mem_used_ = 0;
+	is_exit_ = false;
+	for (int i = 0; i < thread_count; i++)
+		workers_.push_back(unique_ptr<Worker>(new Worker));
+	for (int i = 0; i < thread_count; i++)
+		workers_[i]->th = thread(&XFileService::Work, this, i);
+}
+
+/////////////////////////////////////////////////////////////////
+/// ύһ̵߳Ķ
+int XFileService::Add(const XFileJob& job)
+{
+	if (workers_.empty())
+		return -1;
+	Task task;
+	task.job = job;
+	task.add_time = chrono::steady_clock::now();
+	int index = 0;
+	{
+		unique_lock<mutex> lock(mux_);
+		task.id = next_id_++;
+		index = next_worker_;
+		next_worker_ = (next_worker_ + 1) % workers_.size();
+		pending_++;
+	}
+	int id = task.id;
+	Worker& w = *workers_[index];
+	{
+		unique_lock<mutex> lock(w.mux);
+		w.tasks.push_back(move(task));
+	}
+
+	//кټ߳̿ʱһȡ
+	{
+		unique_lock<mutex> lock(mux_);
+		queued_++;
+	}
+	cv_.notify_one();
+	return id;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ֱύȫ
+void XFileService::Wait()
+{
+	unique_lock<mutex> lock(mux_);
+	done_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+/////////////////////////////////////////////////////////////////
+/// ȴύɣй߳
+void XFileService::Stop()
+{
+	if (workers_.empty())
+		return;
+	Wait();
+	{
+		unique_lock<mutex> lock(mux_);
+		is_exit_ = true;
+	}
+	cv_.notify_all();
+	for (auto& w : workers_)
+	{
+		if (w->th.joinable())
+			w->th.join();
+	}
+	workers_.clear();
+}
+
+XFileService::~XFileService()
+{
+	Stop();
+}
+
+//ȡԼͷûٴβȡ
+void XFileService::Pop(int index, Task& task)
+{
+	int count = (int)workers_.size();
+	for (;;)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			Worker& w = *workers_[(index + i) % count];
+			unique_lock<mutex> lock(w.mux);
+			if (w.tasks.empty())
+				continue;
+			if (i == 0)
+			{
+				task = move(w.tasks.front());
+				w.tasks.pop_front();
+			}
+			else
+			{
+				task = move(w.tasks.back());
+				w.tasks.pop_back();
+			}
+			return;
+		}
+	}
+}
+
+//߳
+void XFileService::Work(int index)
+{
+	for (;;)
+	{
+		{
+			unique_lock<mutex> lock(mux_);
+			cv_.wait(lock, [this] { return is_exit_ || queued_ > 0; });
+			if (queued_ == 0) return;
+			queued_--;
+		}
+		Task task;
+		Pop(index, task);
+		RunTask(index, task);
+		{
+			unique_lock<mutex> lock(mux_);
+			pending_--;
+		}
+		done_cv_.notify_all();
+	}
+}
+
+//ִһ
+void XFileService::RunTask(int index, Task& task)
+{
+	Worker& w = *workers_[index];
+	XFileJob& job = task.job;
+	XFileJobResult re;
+	re.id = task.id;
+	re.thread_index = index;
+
+	//СļҪĻ壬ļС䣬һFinal
+	int buf_size = buf_size_;
+	struct stat st;
+	if (stat(job.in_filename.c_str(), &st) == 0 && st.st_size < buf_size)
+	{
+		long long size = (st.st_size + XFILE_SERVICE_ALIGN) / XFILE_SERVICE_ALIGN * XFILE_SERVICE_ALIGN;
+		if (size < buf_size)
+			buf_size = (int)size;
+	}
+	long long mem = Acquire((long long)buf_size * buf_count_);
+
+	auto start = chrono::steady_clock::now();
+	re.wait_ms = chrono::duration<double, milli>(start - task.add_time).count();
+	if (w.fc.Init(job.type, job.pass, job.is_en, buf_size, buf_count_))
+	{
+		re.is_ok = w.fc.Encrypt(job.in_filename, job.out_filename, job.backend, job.is_direct);
+		if (re.is_ok)
+			re.iv = w.fc.iv();
+		XFileStat st = w.fc.stat();
+		re.in_size = st.in_size;
+		re.out_size = st.out_size;
+		re.read_ms = st.read_ms;
+		re.cipher_ms = st.cipher_ms;
+		re.write_ms = st.write_ms;
+	}
+	auto end = chrono::steady_clock::now();
+
+	//岻߳ռõڴ治Ԥ
+	w.fc.Clear();
+	Release(mem);
+
+	re.ms = chrono::duration<double, milli>(end - start).count();
+	if (re.ms > 0)
+		re.mbps = re.in_size / (1024.0 * 1024.0) / (re.ms / 1000.0);
+	if (callback_)
+		callback_(job, re);
+}
+
+//ȴռڴԤ㣬񳬳Ԥʱȫ黹ռȫԤ
+long long XFileService::Acquire(long long size)
+{
+	if (mem_budget_ <= 0)
+		return 0;
+	if (size > mem_budget_)
+		size = mem_budget_;
+	unique_lock<mutex> lock(mux_);
+	mem_cv_.wait(lock, [&] { return mem_used_ + size <= mem_budget_; });
+	mem_used_ += size;
+	return size;
+}
+
+//黹ڴԤ
+void XFileService::Release(long long size)
+{
+	{
+		unique_lock<mutex> lock(mux_);
+		mem_used_ -= size;
+	}
+	mem_cv_.notify_all();
+}
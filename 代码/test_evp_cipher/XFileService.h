@@ -0,0 +1,164 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include "XFileCrypt.h"
+
+//ĬڴԤ㣬ͬʱִеĻϼ
+#define XFILE_MEM_BUDGET (256LL * 1024 * 1024)
+
+//һļӽ
+struct XFileJob
+{
+	XSecType type = XAES128_CBC;
+	std::string pass;
+	bool is_en = true;
+	std::string in_filename;
+	std::string out_filename;
+	XFileBackend backend = XFILE_PIPELINE;
+
+	//XFILE_URINGļʹO_DIRECT
+	bool is_direct = false;
+};
+
+//һִн
+struct XFileJobResult
+{
+	//Addص
+	int id = 0;
+
+	bool is_ok = false;
+	long long in_size = 0;
+	long long out_size = 0;
+
+	//ִĹ߳
+	int thread_index = 0;
+
+	//ύʼִеĵȴʱ䣨ȴڴԤ㣩
+	double wait_ms = 0;
+
+	//ӽܺʱ
+	double ms = 0;
+
+	//׶κʱ룬XFileStat
+	double read_ms = 0;
+	double cipher_ms = 0;
+	double write_ms = 0;
+
+	//ȡݵMB/s
+	double mbps = 0;
+
+	//ivÿ񵥶ɲдļͷECBΪ
+	std::string iv;
+};
+
+/*
+XFileService fs;
+fs.SetCallback([](const XFileJob& job, const XFileJobResult& re) { ... });
+fs.Start();
+XFileJob job;
+job.pass = "1234567812345678";
+job.in_filename = "data.csv";
+job.out_filename = "data.csv.enc";
+fs.Add(job);
+fs.Wait();
+*/
+class XFileService
+{
+public:
+	//ɻصڹ߳еãĻصͬʱ
+	typedef std::function<void(const XFileJob&, const XFileJobResult&)> Callback;
+
+	/////////////////////////////////////////////////////////////////
+	/// ̣߳ÿ߳һXFileCryptԿ߳ڸ
+	/// @para thread_count ߳Сڵ0ȡCPU
+	/// @para mem_budget ͬʱִе񻺳ϼޣʱȴ
+	///		  񳬳ԤʱռȫԤִУСڵ0
+	/// @para buf_size ÿÿ黺ֵСļļС
+	/// @para buf_count ÿĻ
+	void Start(int thread_count = 0, long long mem_budget = XFILE_MEM_BUDGET,
+		int buf_size = XFILE_BUF_SIZE, int buf_count = XFILE_BUF_COUNT);
+
+	/////////////////////////////////////////////////////////////////
+	/// ɻصStartǰ
+	void SetCallback(Callback cb) { callback_ = cb; }
+
+	/////////////////////////////////////////////////////////////////
+	/// ύһ̵߳ĶУ̴߳ȡ
+	/// @return ţδ-1
+	int Add(const XFileJob& job);
+
+	/////////////////////////////////////////////////////////////////
+	/// ֱύȫ
+	void Wait();
+
+	/////////////////////////////////////////////////////////////////
+	/// ȴύɣй߳
+	void Stop();
+
+	//߳
+	int thread_count() { return (int)workers_.size(); }
+
+	~XFileService();
+
+private:
+	struct Task
+	{
+		int id = 0;
+		XFileJob job;
+		std::chrono::steady_clock::time_point add_time;
+	};
+
+	//̺߳
+	struct Worker
+	{
+		std::deque<Task> tasks;
+		std::mutex mux;
+		XFileCrypt fc;
+		std::thread th;
+	};
+
+	//߳
+	void Work(int index);
+
+	//ȡԼͷûٴβȡ
+	void Pop(int index, Task& task);
+
+	//ִһ
+	void RunTask(int index, Task& task);
+
+	//ȴռڴԤ
+	long long Acquire(long long size);
+
+	//黹ڴԤ
+	void Release(long long size);
+
+	std::vector<std::unique_ptr<Worker> > workers_;
+	Callback callback_;
+	int buf_size_ = XFILE_BUF_SIZE;
+	int buf_count_ = XFILE_BUF_COUNT;
+
+	std::mutex mux_;
+	std::condition_variable cv_;
+	bool is_exit_ = false;
+
+	//δȡߵ߳ȼһȡ֤һȡ
+	int queued_ = 0;
+
+	//ύδɵ
+	int pending_ = 0;
+	std::condition_variable done_cv_;
+
+	int next_id_ = 0;
+	int next_worker_ = 0;
+
+	long long mem_budget_ = XFILE_MEM_BUDGET;
+	long long mem_used_ = 0;
+	std::condition_variable mem_cv_;
+};
@@ -1,18 +1,301 @@
 #include "XSec.h"
+#include "XThreadPool.h"
 #include <openssl/evp.h>
 #include <openssl/err.h>
+#include <openssl/crypto.h>
+#include <openssl/provider.h>
 #include <iostream>
+#include <vector>
+#include <map>
+#include <mutex>
 using namespace std;
 
-void XSec::close()
+//CTRģʽС
+#define CTR_BLOCK_SIZE 16
+
+//дʱÿֿСֽ̫С̵߳ȿڼ
+#define MIN_CHUNK_SIZE (64 * 1024)
+
+//һƴӵֶֽδ
+#define XSEC_BATCH_SIZE (64 * 1024)
+
+//ԿĻĿȫؽ
+#define XSEC_CACHE_MAX 1024
+
+static bool IsECB(XSecType type)
+{
+	switch (type)
+	{
+	case XDES_ECB:
+	case X3DES_ECB:
+	case XAES128_ECB:
+	case XAES192_ECB:
+	case XAES256_ECB:
+	case XSM4_ECB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool IsCBC(XSecType type)
+{
+	switch (type)
+	{
+	case XDES_CBC:
+	case X3DES_CBC:
+	case XAES128_CBC:
+	case XAES192_CBC:
+	case XAES256_CBC:
+	case XSM4_CBC:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/////////////////////////////////////////////////////////////////
+/// ǷAEADģʽ
+bool XSec::IsAEAD(XSecType type)
+{
+	switch (type)
+	{
+	case XAES128_GCM:
+	case XAES192_GCM:
+	case XAES256_GCM:
+	case XSM4_GCM:
+	case XCHACHA20_POLY1305:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//ƻȡ㷨ûEVP_xxx()ӿڵ㷨ȡNULL
+static const EVP_CIPHER* FetchCipher(const char* name)
+{
+	const EVP_CIPHER* cipher = EVP_CIPHER_fetch(NULL, name, NULL);
+	if (!cipher)
+	{
+		cerr << name << " is not supported by this OpenSSL build" << endl;
+		ERR_clear_error();
+	}
+	return cipher;
+}
+
+//DESǷEVPTestCipherԱǰʱԹر
+static bool use_evp_des = true;
+
+//ֻlegacy provider˽пģıȫֿĵprovider˳ǰͷ
+static OSSL_LIB_CTX* LegacyLibCtx()
+{
+	OSSL_LIB_CTX* libctx = OSSL_LIB_CTX_new();
+	if (libctx && !OSSL_PROVIDER_load(libctx, "legacy"))
+	{
+		OSSL_LIB_CTX_free(libctx);
+		libctx = NULL;
+	}
+	return libctx;
+}
+
+//OpenSSL 3.0ĵDESlegacy providerУ˽паƻȡ
+//ȡNULLɵ˻DES_ecb_encrypt
+static const EVP_CIPHER* FetchLegacyCipher(const char* name)
+{
+	static OSSL_LIB_CTX* libctx = LegacyLibCtx();
+	const EVP_CIPHER* cipher = NULL;
+	if (libctx)
+		cipher = EVP_CIPHER_fetch(libctx, name, NULL);
+	ERR_clear_error();
+	return cipher;
+}
+
+static bool IsCTR(XSecType type)
+{
+	switch (type)
+	{
+	case XAES128_CTR:
+	case XAES192_CTR:
+	case XAES256_CTR:
+	case XSM4_CTR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//CTRAEADģʽʽnonceĬȫ0
+static bool NeedNonce(XSecType type)
+{
+	return IsCTR(type) || XSec::IsAEAD(type);
+}
+
+//CTR128λˣn
+static void CtrAdd(unsigned char* ctr, unsigned long long n)
+{
+	for (int i = CTR_BLOCK_SIZE - 1; i >= 0 && n > 0; i--)
+	{
+		n += ctr[i];
+		ctr[i] = (unsigned char)n;
+		n >>= 8;
+	}
+}
+
+//ȥPKCS7䣬ȥĴС䲻Է-1
+//һֽnֽ1<=n<=Сnֽڶn
+static int UnPad(const unsigned char* data, int size, int block_size)
+{
+	if (size <= 0 || size % block_size != 0) return -1;
+	int pad = data[size - 1];
+	if (pad < 1 || pad > block_size) return -1;
+	unsigned char diff = 0;
+	for (int i = size - pad; i < size; i++)
+		diff |= data[i] ^ pad;
+	return diff ? -1 : size - pad;
+}
+
+//ÿ߳һӽģ߳˳ʱͷ
+static EVP_CIPHER_CTX* ThreadCtx()
+{
+	struct CtxHolder
+	{
+		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+		~CtxHolder() { EVP_CIPHER_CTX_free(ctx); }
+	};
+	static thread_local CtxHolder holder;
+	return holder.ctx;
+}
+
+//ԿĻѾչԿδiv
+struct XSecCacheItem
+{
+	EVP_CIPHER_CTX* ctx = nullptr;
+	DES_key_schedule ks;
+};
+
+// keyΪ ++ȫԿ
+static map<string, XSecCacheItem> sec_cache;
+static mutex sec_cache_mux;
+
+//࣬ͬһDESԿȿܻksҲܻEVP
+#define CACHE_DE 0
+#define CACHE_EN 1
+#define CACHE_DES_KS 2
+
+static string CacheKey(XSecType type, int kind, const unsigned char* key, int key_size)
+{
+	string k;
+	k.push_back((char)type);
+	k.push_back((char)kind);
+	k.append((const char*)key, key_size);
+	return k;
+}
+
+//߼
+static void ClearCacheLocked()
+{
+	for (auto& item : sec_cache)
+	{
+		EVP_CIPHER_CTX_free(item.second.ctx);
+		OPENSSL_cleanse(&item.second.ks, sizeof(item.second.ks));
+		OPENSSL_cleanse((void*)item.first.data(), item.first.size());
+	}
+	sec_cache.clear();
+}
+
+//ӻ渴չԿĵctxûʼ뻺
+static bool LoadCtx(XSecType type, bool is_en, const EVP_CIPHER* cipher,
+	const unsigned char* key, EVP_CIPHER_CTX* ctx)
+{
+	string k = CacheKey(type, is_en ? CACHE_EN : CACHE_DE, key, EVP_CIPHER_key_length(cipher));
+	unique_lock<mutex> lock(sec_cache_mux);
+	auto it = sec_cache.find(k);
+	if (it == sec_cache.end())
+	{
+		if (sec_cache.size() >= XSEC_CACHE_MAX)
+			ClearCacheLocked();
+		auto tmpl = EVP_CIPHER_CTX_new();
+		if (!EVP_CipherInit_ex(tmpl, cipher, NULL, key, NULL, is_en))
+		{
+			ERR_print_errors_fp(stderr);
+			EVP_CIPHER_CTX_free(tmpl);
+			OPENSSL_cleanse(&k[0], k.size());
+			return false;
+		}
+		it = sec_cache.insert(make_pair(k, XSecCacheItem())).first;
+		it->second.ctx = tmpl;
+	}
+	OPENSSL_cleanse(&k[0], k.size());
+	return EVP_CIPHER_CTX_copy(ctx, it->second.ctx) == 1;
+}
+
+//DESԿչ뻺
+static void LoadDesKey(XSecType type, const unsigned char* key, DES_key_schedule* ks)
+{
+	string k = CacheKey(type, CACHE_DES_KS, key, sizeof(DES_cblock));
+	unique_lock<mutex> lock(sec_cache_mux);
+	auto it = sec_cache.find(k);
+	if (it == sec_cache.end())
+	{
+		if (sec_cache.size() >= XSEC_CACHE_MAX)
+			ClearCacheLocked();
+		it = sec_cache.insert(make_pair(k, XSecCacheItem())).first;
+		DES_set_key((const_DES_cblock*)key, &it->second.ks);
+	}
+	OPENSSL_cleanse(&k[0], k.size());
+	*ks = it->second.ks;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ԿĻ沢еԿ
+void XSec::ClearCache()
+{
+	unique_lock<mutex> lock(sec_cache_mux);
+	ClearCacheLocked();
+}
+
+//״̬Ķ´Init
+void XSec::Clear()
 {
 	//ʼiv_
 	memset(iv_, 0, sizeof(iv_));
+	iv_size_ = 0;
+	has_iv_ = false;
+	OPENSSL_cleanse(key_, sizeof(key_));
+	cipher_ = nullptr;
+	ctr_blocks_ = 0;
+	OPENSSL_cleanse(tag_, sizeof(tag_));
+	has_tag_ = false;
+	des_ks_ = false;
+	OPENSSL_cleanse(tail_, sizeof(tail_));
+	tail_size_ = 0;
+}
+
+/////////////////////////////////////////////////////////////////
+/// DESǷʹEVP鴦ĬtrueֻӰ֮Init
+void XSec::SetEvpDes(bool use)
+{
+	use_evp_des = use;
+}
+
+void XSec::close()
+{
+	Clear();
 	if (ctx_)
 	{
 		EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx_);
 		ctx_ = nullptr;
 	}
+	if (ecb_ctx_)
+	{
+		EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ecb_ctx_);
+		ecb_ctx_ = nullptr;
+	}
+	if (!batch_buf_.empty())
+	{
+		OPENSSL_cleanse(batch_buf_.data(), batch_buf_.size());
+		batch_buf_.clear();
+	}
 }
 
 
@@ -21,10 +304,13 @@ void XSec::close()
 /// @para type 
 /// @para pass ԿǶ
 /// @is_en true  false
+/// @para iv ʼDESΪ8ֽڣAEADģʽΪ12ֽnonceΪС
+///		  ECB CBCΪNULLȫ0CTRAEADģʽΪNULLֻԿӽǰResetnonce
+///		  CTRAEADģʽͬһԿÿϢnonceظ
 /// @return Ƿɹ
-bool XSec::Init(XSecType type, const std::string& pass, bool is_en)
+bool XSec::Init(XSecType type, const std::string& pass, bool is_en, const unsigned char* iv)
 {
-	close();
+	Clear();
 	this->type_ = type;
 	this->is_en_ = is_en;
 	
@@ -40,7 +326,19 @@ bool XSec::Init(XSecType type, const std::string& pass, bool is_en)
 	{
 	case XDES_ECB:
 	case XDES_CBC:
+	{
+		//EVPһδ飬DES_ecb_encrypt죬ֻȡһβͷ
+		static const EVP_CIPHER* des_ecb = FetchLegacyCipher("DES-ECB");
+		static const EVP_CIPHER* des_cbc = FetchLegacyCipher("DES-CBC");
+		if (use_evp_des)
+			cipher = (type == XDES_ECB) ? des_ecb : des_cbc;
+		if (cipher)
+			break;
+
+		//ûlegacy providerʹDES_key_schedule鴦
+		des_ks_ = true;
 		block_size_ = DES_KEY_SZ;
+		iv_size_ = (type == XDES_CBC) ? (int)sizeof(DES_cblock) : 0;
 		//8ֽڵĶ
 		if (key_size > block_size_)
 		{
@@ -48,8 +346,12 @@ bool XSec::Init(XSecType type, const std::string& pass, bool is_en)
 		}
 		/// 8ֽڵĶٵĲ0
 		memcpy(key, pass.data(), key_size);
-		DES_set_key((const_DES_cblock*)key, &ks_);
+		LoadDesKey(type, key, &ks_);
+		OPENSSL_cleanse(key, sizeof(key));
+		if (iv)
+			memcpy(iv_, iv, sizeof(DES_cblock));
 		return true;
+	}
 
 	case X3DES_ECB:
 		cipher = EVP_des_ede3_ecb();
@@ -81,6 +383,37 @@ bool XSec::Init(XSecType type, const std::string& pass, bool is_en)
 	case XSM4_CBC:
 		cipher = EVP_sm4_cbc();
 		break;
+	case XAES128_CTR:
+		cipher = EVP_aes_128_ctr();
+		break;
+	case XAES192_CTR:
+		cipher = EVP_aes_192_ctr();
+		break;
+	case XAES256_CTR:
+		cipher = EVP_aes_256_ctr();
+		break;
+	case XSM4_CTR:
+		cipher = EVP_sm4_ctr();
+		break;
+	case XAES128_GCM:
+		cipher = EVP_aes_128_gcm();
+		break;
+	case XAES192_GCM:
+		cipher = EVP_aes_192_gcm();
+		break;
+	case XAES256_GCM:
+		cipher = EVP_aes_256_gcm();
+		break;
+	case XSM4_GCM:
+	{
+		//OpenSSL 3.0ûEVP_sm4_gcm()°汾ͨƻȡֻȡһβͷ
+		static const EVP_CIPHER* sm4_gcm = FetchCipher("SM4-GCM");
+		cipher = sm4_gcm;
+		break;
+	}
+	case XCHACHA20_POLY1305:
+		cipher = EVP_chacha20_poly1305();
+		break;
 	default:
 		break;
 	}
@@ -89,18 +422,46 @@ bool XSec::Init(XSecType type, const std::string& pass, bool is_en)
 
 	//С
 	block_size_ = EVP_CIPHER_block_size(cipher);
+	iv_size_ = EVP_CIPHER_iv_length(cipher);
 
 	if (key_size > EVP_CIPHER_key_length(cipher))
 		key_size = EVP_CIPHER_key_length(cipher);
 	memcpy(key, pass.data(), key_size);
+	memcpy(key_, key, sizeof(key_));
+	cipher_ = cipher;
+	if (iv)
+		memcpy(iv_, iv, EVP_CIPHER_iv_length(cipher));
+	has_iv_ = iv != nullptr;
 
-	//ӽ
-	ctx_ = EVP_CIPHER_CTX_new();
+	//ӽģظInitʱ
+	if (!ctx_)
+		ctx_ = EVP_CIPHER_CTX_new();
 
-	//ʼ
-	int re = EVP_CipherInit(
+	//ƻչԿģֻiv
+	bool is_load = LoadCtx(type, is_en_, cipher, key, (EVP_CIPHER_CTX*)ctx_);
+
+	//CTRģʽʱͬһԿECBԿ
+	if (is_load && IsCTR(type))
+	{
+		XSecType ecb_type = XSM4_ECB;
+		const EVP_CIPHER* ecb = EVP_sm4_ecb();
+		if (type == XAES128_CTR) { ecb_type = XAES128_ECB; ecb = EVP_aes_128_ecb(); }
+		if (type == XAES192_CTR) { ecb_type = XAES192_ECB; ecb = EVP_aes_192_ecb(); }
+		if (type == XAES256_CTR) { ecb_type = XAES256_ECB; ecb = EVP_aes_256_ecb(); }
+		if (!ecb_ctx_)
+			ecb_ctx_ = EVP_CIPHER_CTX_new();
+		is_load = LoadCtx(ecb_type, true, ecb, key, (EVP_CIPHER_CTX*)ecb_ctx_);
+		if (is_load)
+			EVP_CIPHER_CTX_set_padding((EVP_CIPHER_CTX*)ecb_ctx_, 0);
+	}
+	OPENSSL_cleanse(key, sizeof(key));
+	if (!is_load)
+		return false;
+
+	//ʼģCTRAEADģʽûnonceʱiv
+	int re = EVP_CipherInit_ex(
 		(EVP_CIPHER_CTX*)ctx_,
-		cipher, key, iv_, is_en_
+		NULL, NULL, NULL, (has_iv_ || !NeedNonce(type)) ? iv_ : NULL, is_en_
 	);
 	if(!re)
 	{
@@ -108,6 +469,9 @@ bool XSec::Init(XSecType type, const std::string& pass, bool is_en)
 		return false;
 	}
 
+	//UpdatePKCS7ֻFinalд
+	EVP_CIPHER_CTX_set_padding((EVP_CIPHER_CTX*)ctx_, 0);
+
 	//cout << "EVP_CipherInit success!" << endl;
 
 	return true;
@@ -115,55 +479,590 @@ bool XSec::Init(XSecType type, const std::string& pass, bool is_en)
 
 }
 
+/////////////////////////////////////////////////////////////////
+/// ʼµϢԿֻivInitһԿչ
+/// @para iv ʼͬInitECB CBCΪNULLȫ0
+/// @return ǷɹCTRAEADģʽivΪNULLfalse
+bool XSec::Reset(const unsigned char* iv)
+{
+	memset(iv_, 0, sizeof(iv_));
+	has_iv_ = iv != nullptr;
+	ctr_blocks_ = 0;
+	OPENSSL_cleanse(tag_, sizeof(tag_));
+	has_tag_ = false;
+	OPENSSL_cleanse(tail_, sizeof(tail_));
+	tail_size_ = 0;
+
+	if (des_ks_)
+	{
+		if (iv)
+			memcpy(iv_, iv, sizeof(DES_cblock));
+		return true;
+	}
+	if (!ctx_ || !cipher_) return false;
+	if (!iv && NeedNonce(type_)) return false;
+	if (iv)
+		memcpy(iv_, iv, EVP_CIPHER_iv_length((const EVP_CIPHER*)cipher_));
+
+	//cipherkeyNULLֻivͻ״̬
+	int re = EVP_CipherInit_ex((EVP_CIPHER_CTX*)ctx_, NULL, NULL, NULL, iv_, is_en_);
+	if (!re)
+	{
+		ERR_print_errors_fp(stderr);
+		return false;
+	}
+	//EncryptBatchܴ
+	EVP_CIPHER_CTX_set_padding((EVP_CIPHER_CTX*)ctx_, 0);
+	return true;
+}
+
 /////////////////////////////////////////////////////////////////
 /// ӽ
 /// @para in 
 /// @para in_size ݴС
-/// @para out 
+/// @para out ݣʱin_size+СԺinͬԭؼӽܣ
+/// @para is_end һݣfalseͬUpdatetrueͬUpdate+Final
 /// @return ɹؼӽֽܺڴСʧܷ0
 int XSec::Encrypt(const unsigned char* in, int in_size, unsigned char* out, bool is_end)
 {
-	if (type_ == XDES_ECB) 
+	int out_len = Update(in, in_size, out);
+	if (out_len < 0) return 0;
+	if (!is_end) return out_len;
+
+	int final_len = Final(out + out_len);
+	if (final_len < 0) return 0;
+	return out_len + final_len;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ӽСݣһβڶڲ´εʱ
+/// ʱһFinalȥPKCS7
+/// @para in 
+/// @para in_size ݴС
+/// @para out ݣin_size+СԺinͬԭؼӽܣ
+/// @return ɹֽݲһʱΪ0ʧܷ-1
+int XSec::Update(const unsigned char* in, int in_size, unsigned char* out)
+{
+	if (in_size < 0) return -1;
+	if (!has_iv_ && NeedNonce(type_)) return -1;
+	if (in_size == 0) return 0;
+
+	//ģʽCTR AEADûз飬EVPֱӴ
+	if (block_size_ <= 1)
 	{
-		if (is_en_) 
+		if (!ctx_) return -1;
+		int out_len = 0;
+		if (!EVP_CipherUpdate((EVP_CIPHER_CTX*)ctx_, out, &out_len, in, in_size))
 		{
-			return EnDesECB(in, in_size, out, is_end);
+			ERR_print_errors_fp(stderr);
+			return -1;
 		}
-		else
+		return out_len;
+	}
+
+	//ֽ룬ʱһFinal
+	int total = tail_size_ + in_size;
+	int len = total - total % block_size_;
+	if (!is_en_ && len == total)
+		len -= block_size_;
+	if (len <= 0)
+	{
+		memcpy(tail_ + tail_size_, in, in_size);
+		tail_size_ = total;
+		return 0;
+	}
+
+	//1 ϴʣݴinвһ飬ȼӽܵʱ
+	unsigned char block[sizeof(tail_)];
+	int head = 0;
+	if (tail_size_ > 0)
+	{
+		head = block_size_ - tail_size_;
+		memcpy(tail_ + tail_size_, in, head);
+		if (UpdateBlocks(tail_, block_size_, block) != block_size_)
+			return -1;
+	}
+
+	//2 ʣβȱ棬ԭشʱƶḲ
+	int rest = total - len;
+	unsigned char next[sizeof(tail_)];
+	memcpy(next, in + in_size - rest, rest);
+
+	//3 мĲֱinout֮䴦
+	int mid = len - (tail_size_ > 0 ? block_size_ : 0);
+	if (tail_size_ > 0 && out == in)
+	{
+		//ԭأм䲿ԭλôٺƸһλ
+		if (mid > 0 && UpdateBlocks(in + head, mid, out + head) != mid)
+			return -1;
+		memmove(out + block_size_, out + head, mid);
+		memcpy(out, block, block_size_);
+	}
+	else
+	{
+		int off = 0;
+		if (tail_size_ > 0)
 		{
-			return DeDesECB(in, in_size, out, is_end);
+			memcpy(out, block, block_size_);
+			off = block_size_;
 		}
+		if (mid > 0 && UpdateBlocks(in + head, mid, out + off) != mid)
+			return -1;
 	}
-	else if(type_ == XDES_CBC)
+
+	memcpy(tail_, next, rest);
+	tail_size_ = rest;
+	OPENSSL_cleanse(block, sizeof(block));
+	OPENSSL_cleanse(next, sizeof(next));
+	return len;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ӽܣڲʣ
+/// ʱPKCS7ʱȥPKCS7AEADģʽɱǩУǩ
+/// @para out ݣС
+/// @return ɹֽʧܣAEADǩУʧܣ-1
+int XSec::Final(unsigned char* out)
+{
+	int tail_size = tail_size_;
+	tail_size_ = 0;
+	if (!has_iv_ && NeedNonce(type_)) return -1;
+
+	//ʱı밴
+	if (block_size_ > 1 && !is_en_ && tail_size != block_size_)
+		return -1;
+
+	int re = -1;
+	if (des_ks_ && type_ == XDES_ECB)
 	{
-		if (is_en_)
+		re = is_en_ ? EnDesECB(tail_, tail_size, out, true) : DeDesECB(tail_, tail_size, out, true);
+	}
+	else if (des_ks_ && type_ == XDES_CBC)
+	{
+		re = is_en_ ? EnDesCBC(tail_, tail_size, out, true) : DeDesCBC(tail_, tail_size, out, true);
+	}
+	else if (ctx_)
+	{
+		auto ctx = (EVP_CIPHER_CTX*)ctx_;
+		int out_len = 0;
+		int final_len = 0;
+
+		//ģʽֻһϴPKCS7
+		if (block_size_ > 1)
+		{
+			EVP_CIPHER_CTX_set_padding(ctx, EVP_PADDING_PKCS7);
+			if (tail_size > 0 && !EVP_CipherUpdate(ctx, out, &out_len, tail_, tail_size))
+				out_len = -1;
+		}
+		if (out_len >= 0 && EVP_CipherFinal_ex(ctx, out + out_len, &final_len))
 		{
-			return EnDesCBC(in, in_size, out, is_end);
+			re = out_len + final_len;
+			if (IsAEAD(type_) && is_en_)
+			{
+				EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, XSEC_TAG_SIZE, tag_);
+				has_tag_ = true;
+			}
 		}
 		else
 		{
-			return DeDesCBC(in, in_size, out, is_end);
+			//ǩУʧܣӡջɵߴ
+			ERR_clear_error();
 		}
+		if (block_size_ > 1)
+			EVP_CIPHER_CTX_set_padding(ctx, 0);
 	}
+	OPENSSL_cleanse(tail_, sizeof(tail_));
+	return re;
+}
 
-	//һݣPKCS7
-	if (is_end)
+//////////////////////////////////////////////////////////////////
+/// ӽܰݣ
+/// @return ֽʧܷ-1
+int XSec::UpdateBlocks(const unsigned char* in, int in_size, unsigned char* out)
+{
+	if (des_ks_ && type_ == XDES_ECB)
+		return is_en_ ? EnDesECB(in, in_size, out, false) : DeDesECB(in, in_size, out, false);
+	if (des_ks_ && type_ == XDES_CBC)
+		return is_en_ ? EnDesCBC(in, in_size, out, false) : DeDesCBC(in, in_size, out, false);
+	if (!ctx_) return -1;
+	int out_len = 0;
+	if (!EVP_CipherUpdate((EVP_CIPHER_CTX*)ctx_, out, &out_len, in, in_size))
 	{
-		EVP_CIPHER_CTX_set_padding((EVP_CIPHER_CTX*)ctx_, EVP_PADDING_PKCS7);
+		ERR_print_errors_fp(stderr);
+		return -1;
 	}
-	else
+	return out_len;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ӽܶС¼ÿ¼PKCS7ʹԼiv
+/// ECBCTRģʽѶ¼ϲһεãAES-NIˮ
+/// ģʽֻһ䷽ʽظʼԿ
+/// ú״̬ȷٵEncrypt UpdateǰReset
+/// @para records ¼飬дoutout_size
+/// @para count ¼
+/// @return ɹļ¼
+int XSec::EncryptBatch(XSecRecord* records, int count)
+{
+	if (!records || count <= 0) return 0;
+	for (int i = 0; i < count; i++)
+		records[i].out_size = 0;
+
+	//DES ks_ ԭĽӿ
+	if (des_ks_)
 	{
-		EVP_CIPHER_CTX_set_padding((EVP_CIPHER_CTX*)ctx_, 0);
+		unsigned char iv[sizeof(DES_cblock)];
+		memcpy(iv, iv_, sizeof(iv));
+		int ok = 0;
+		for (int i = 0; i < count; i++)
+		{
+			auto& r = records[i];
+			memcpy(iv_, r.iv ? r.iv : iv, sizeof(iv));
+			if (!is_en_ && (r.in_size <= 0 || r.in_size % block_size_ != 0))
+				continue;
+
+			//EncryptʧܺͿĶ0ֿ֣FinalҪãUpdateʣ
+			int len = Update(r.in, r.in_size, r.out);
+			int final_len = Final(r.out + (len > 0 ? len : 0));
+			if (len < 0 || final_len < 0)
+				continue;
+			r.out_size = len + final_len;
+			ok++;
+		}
+		memcpy(iv_, iv, sizeof(iv));
+		return ok;
+	}
+	if (!ctx_ || !cipher_) return 0;
+	if (IsECB(type_))
+		return BatchECB(records, count);
+	if (IsCTR(type_))
+		return BatchCTR(records, count);
+
+	//CBCAEADģʽ¼ֻ֮iv
+	auto ctx = (EVP_CIPHER_CTX*)ctx_;
+	bool is_aead = IsAEAD(type_);
+	if (!is_aead)
+		EVP_CIPHER_CTX_set_padding(ctx, EVP_PADDING_PKCS7);
+	int ok = 0;
+	for (int i = 0; i < count; i++)
+	{
+		auto& r = records[i];
+
+		//AEADܹnonceûivļ¼ʧ
+		if (is_aead && !r.iv)
+			continue;
+		if (!EVP_CipherInit_ex(ctx, NULL, NULL, NULL, r.iv ? r.iv : iv_, -1))
+			continue;
+		if (is_aead && !is_en_)
+		{
+			if (!r.tag) continue;
+			EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, XSEC_TAG_SIZE, r.tag);
+		}
+		int out_len = 0;
+		if (r.in_size > 0 && !EVP_CipherUpdate(ctx, r.out, &out_len, r.in, r.in_size))
+			continue;
+		int final_len = 0;
+		if (!EVP_CipherFinal_ex(ctx, r.out + out_len, &final_len))
+		{
+			ERR_clear_error();
+			continue;
+		}
+		if (is_aead && is_en_ && r.tag)
+			EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, XSEC_TAG_SIZE, r.tag);
+		r.out_size = out_len + final_len;
+		ok++;
 	}
+	return ok;
+}
 
+//////////////////////////////////////////////////////////////////
+/// ECBм¼ƴһһμӽ
+int XSec::BatchECB(XSecRecord* records, int count)
+{
+	auto ctx = (EVP_CIPHER_CTX*)ctx_;
+	EVP_CIPHER_CTX_set_padding(ctx, 0);
+	int ok = 0;
+	int i = 0;
+	while (i < count)
+	{
+		//1 ƴӣʱÿ¼PKCS7ʱҪ
+		int begin = i;
+		int used = 0;
+		for (; i < count; i++)
+		{
+			auto& r = records[i];
+			int size = r.in_size;
+			if (is_en_)
+				size = r.in_size + block_size_ - r.in_size % block_size_;
+			else if (r.in_size <= 0 || r.in_size % block_size_ != 0)
+				size = 0;
+			if (i > begin && used + size > XSEC_BATCH_SIZE)
+				break;
+			if ((int)batch_buf_.size() < used + size)
+				batch_buf_.resize(used + size > XSEC_BATCH_SIZE ? used + size : XSEC_BATCH_SIZE);
+			if (size > 0)
+			{
+				unsigned char* p = batch_buf_.data() + used;
+				memcpy(p, r.in, r.in_size);
+				memset(p + r.in_size, size - r.in_size, size - r.in_size);
+			}
+			used += size;
+		}
+
+		//2 һμӽ
+		int out_len = 0;
+		if (used > 0 && !EVP_CipherUpdate(ctx, batch_buf_.data(), &out_len, batch_buf_.data(), used))
+		{
+			ERR_print_errors_fp(stderr);
+			return ok;
+		}
+
+		//3 ֻظ¼ʱ鲢ȥPKCS7
+		int off = 0;
+		for (int j = begin; j < i; j++)
+		{
+			auto& r = records[j];
+			int size = r.in_size;
+			if (is_en_)
+				size = r.in_size + block_size_ - r.in_size % block_size_;
+			else if (r.in_size <= 0 || r.in_size % block_size_ != 0)
+				continue;
+			const unsigned char* p = batch_buf_.data() + off;
+			off += size;
+			int out_size = size;
+			if (!is_en_)
+			{
+				out_size = UnPad(p, size, block_size_);
+				if (out_size < 0)
+					continue;
+			}
+			memcpy(r.out, p, out_size);
+			r.out_size = out_size;
+			ok++;
+		}
+	}
+	return ok;
+}
+
+//////////////////////////////////////////////////////////////////
+/// CTRм¼ļƴһECBԿ
+int XSec::BatchCTR(XSecRecord* records, int count)
+{
+	//ûivļ¼¼üԿظ
+	auto IsBatchCTRRecord = [](const XSecRecord& r) {
+		return r.in_size >= 0 && r.iv;
+	};
+	auto ecb = (EVP_CIPHER_CTX*)ecb_ctx_;
+	if (!ecb) return 0;
+	int ok = 0;
+	int i = 0;
+	while (i < count)
+	{
+		//1 ÿ¼ļ
+		int begin = i;
+		int used = 0;
+		for (; i < count; i++)
+		{
+			auto& r = records[i];
+			if (!IsBatchCTRRecord(r)) continue;
+			int blocks = (r.in_size + CTR_BLOCK_SIZE - 1) / CTR_BLOCK_SIZE;
+			int size = blocks * CTR_BLOCK_SIZE;
+			if (i > begin && used + size > XSEC_BATCH_SIZE)
+				break;
+			if ((int)batch_buf_.size() < used + size)
+				batch_buf_.resize(used + size > XSEC_BATCH_SIZE ? used + size : XSEC_BATCH_SIZE);
+			unsigned char* p = batch_buf_.data() + used;
+			for (int b = 0; b < blocks; b++)
+			{
+				memcpy(p + b * CTR_BLOCK_SIZE, r.iv, CTR_BLOCK_SIZE);
+				CtrAdd(p + b * CTR_BLOCK_SIZE, b);
+			}
+			used += size;
+		}
+
+		//2 һȫԿ
+		int out_len = 0;
+		if (used > 0 && !EVP_CipherUpdate(ecb, batch_buf_.data(), &out_len, batch_buf_.data(), used))
+		{
+			ERR_print_errors_fp(stderr);
+			return ok;
+		}
+
+		//3 õĻ
+		int off = 0;
+		for (int j = begin; j < i; j++)
+		{
+			auto& r = records[j];
+			if (!IsBatchCTRRecord(r)) continue;
+			const unsigned char* ks = batch_buf_.data() + off;
+			for (int k = 0; k < r.in_size; k++)
+				r.out[k] = r.in[k] ^ ks[k];
+			off += (r.in_size + CTR_BLOCK_SIZE - 1) / CTR_BLOCK_SIZE * CTR_BLOCK_SIZE;
+			r.out_size = r.in_size;
+			ok++;
+		}
+	}
+	return ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// AEADģʽ֤ݣֻ֤ܣEncrypt֮ǰ
+/// @return AEADģʽûnonceʧܷfalse
+bool XSec::SetAAD(const unsigned char* aad, int aad_size)
+{
+	if (!IsAEAD(type_) || !ctx_ || !has_iv_) return false;
 	int out_len = 0;
-	EVP_CipherUpdate((EVP_CIPHER_CTX*)ctx_, out, &out_len, in, in_size);
-	if (out_len <= 0) return 0;
-	
-	//ȡ
-	int out_padding_len = 0;
-	EVP_CipherFinal((EVP_CIPHER_CTX*)ctx_, out + out_len, &out_padding_len);
+	return EVP_CipherUpdate((EVP_CIPHER_CTX*)ctx_, NULL, &out_len, aad, aad_size) == 1;
+}
+
+/////////////////////////////////////////////////////////////////
+/// AEADģʽɣis_end=trueȡ֤ǩ
+/// @para tag XSEC_TAG_SIZEֽ
+/// @return AEADģʽδɼܷfalse
+bool XSec::GetTag(unsigned char* tag)
+{
+	if (!has_tag_) return false;
+	memcpy(tag, tag_, XSEC_TAG_SIZE);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// AEADģʽʱ֤ǩһEncrypt֮ǰ
+/// @para tag XSEC_TAG_SIZEֽ
+/// @return AEADģʽʧܷfalse
+bool XSec::SetTag(const unsigned char* tag)
+{
+	if (!IsAEAD(type_) || is_en_ || !ctx_) return false;
+	return EVP_CIPHER_CTX_ctrl((EVP_CIPHER_CTX*)ctx_, EVP_CTRL_AEAD_SET_TAG,
+		XSEC_TAG_SIZE, (void*)tag) == 1;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ̷ֿ߳ӽܣECBCTRģʽCBCܸ黥̳߳вд
+/// ģʽCBCܣ˻ΪEncrypt
+/// һin_sizeǷСCTRCBCivڶεü
+/// ͬһݲҪEncrypt Update
+/// @para in 
+/// @para in_size ݴС
+/// @para out ݣʱin_size+СԺinͬ
+/// @para is_end һݣһֿϴPKCS7
+/// @return ɹؼӽֽܺڴСʧܷ0
+int XSec::ParallelEncrypt(const unsigned char* in, int in_size, unsigned char* out, bool is_end)
+{
+	bool is_ctr = IsCTR(type_);
+	bool is_cbc = IsCBC(type_);
+	if (is_ctr && !has_iv_) return 0;
+	if (!is_ctr && !IsECB(type_) && !(is_cbc && !is_en_))
+		return Encrypt(in, in_size, out, is_end);
 
+	//CTR룬ECB CBCܷ
+	int align = is_ctr ? CTR_BLOCK_SIZE : block_size_;
+	if (in_size < 0 || align <= 0) return 0;
+	if (!is_end && in_size % align != 0) return 0;
+	if (!is_en_ && !is_ctr && (in_size == 0 || in_size % align != 0)) return 0;
+
+	//ֿ߳ÿ鲻СMIN_CHUNK_SIZE
+	auto pool = XThreadPool::Instance();
+	int chunk_count = pool->thread_count();
+	if (chunk_count > in_size / MIN_CHUNK_SIZE)
+		chunk_count = in_size / MIN_CHUNK_SIZE;
+	if (chunk_count < 1)
+		chunk_count = 1;
+	//ֿС16ֽڶ룬ͬʱ8ֽں16ֽڷ飬ʣݹһ
+	int chunk_size = in_size / chunk_count;
+	chunk_size -= chunk_size % CTR_BLOCK_SIZE;
+
+	//ÿֿiv߳ǰãout == inԭؽʱǰһĻᱻ
+	//CTR: ʼivϷֿǰķ
+	//CBC: ֿǰһķ飬һϴεµiv_
+	vector<unsigned char> ivs(chunk_count * CTR_BLOCK_SIZE, 0);
+	for (int i = 0; i < chunk_count; i++)
+	{
+		unsigned char* iv = ivs.data() + i * CTR_BLOCK_SIZE;
+		int off = i * chunk_size;
+		if (is_cbc && i > 0)
+		{
+			memcpy(iv, in + off - block_size_, block_size_);
+			continue;
+		}
+		memcpy(iv, iv_, CTR_BLOCK_SIZE);
+		if (is_ctr)
+			CtrAdd(iv, ctr_blocks_ + off / CTR_BLOCK_SIZE);
+	}
+
+	//´εôһķ
+	if (is_cbc && in_size >= block_size_)
+		memcpy(iv_, in + in_size - block_size_, block_size_);
+
+	vector<int> out_sizes(chunk_count, -1);
+	vector<function<void()> > tasks;
+	for (int i = 0; i < chunk_count; i++)
+	{
+		int off = i * chunk_size;
+		int size = (i == chunk_count - 1) ? in_size - off : chunk_size;
+		bool is_last = is_end && (i == chunk_count - 1);
+		const unsigned char* iv = ivs.data() + i * CTR_BLOCK_SIZE;
+		tasks.push_back([=, &out_sizes] {
+			out_sizes[i] = EncryptChunk(in + off, size, out + off, iv, is_last);
+		});
+	}
+	pool->Run(tasks);
+
+	int out_size = 0;
+	for (int s : out_sizes)
+	{
+		if (s < 0) return 0;
+		out_size += s;
+	}
+	if (is_ctr)
+		ctr_blocks_ += (in_size + CTR_BLOCK_SIZE - 1) / CTR_BLOCK_SIZE;
+	return out_size;
+}
+
+//////////////////////////////////////////////////////////////////
+/// һֿ飬ʹõǰ߳Լ
+/// @para iv ֿĳʼECBģʽ
+/// @return ֽʧܷ-1
+int XSec::EncryptChunk(const unsigned char* in, int in_size, unsigned char* out, const unsigned char* iv, bool is_last)
+{
+	//DES ks_ֻ߳̿Թ
+	if (des_ks_ && type_ == XDES_ECB)
+	{
+		if (is_en_)
+			return EnDesECB(in, in_size, out, is_last);
+		return DeDesECB(in, in_size, out, is_last);
+	}
+	if (des_ks_ && type_ == XDES_CBC)
+	{
+		//ncbc޸iv÷ֿԼĸ
+		DES_cblock des_iv;
+		memcpy(des_iv, iv, sizeof(des_iv));
+		DES_ncbc_encrypt(in, out, in_size, &ks_, &des_iv, DES_DECRYPT);
+		if (is_last)
+			return UnPad(out, in_size, block_size_);
+		return in_size;
+	}
+
+	auto ctx = ThreadCtx();
+	if (!ctx || !cipher_) return -1;
+
+	int re = EVP_CipherInit_ex(ctx, (const EVP_CIPHER*)cipher_, NULL, key_, iv, is_en_);
+	if (!re)
+	{
+		ERR_print_errors_fp(stderr);
+		return -1;
+	}
+	EVP_CIPHER_CTX_set_padding(ctx, is_last ? EVP_PADDING_PKCS7 : 0);
+
+	int out_len = 0;
+	if (!EVP_CipherUpdate(ctx, out, &out_len, in, in_size))
+		return -1;
+	if (!is_last)
+		return out_len;
+
+	int out_padding_len = 0;
+	if (!EVP_CipherFinal_ex(ctx, out + out_len, &out_padding_len))
+		return -1;
 	return out_len + out_padding_len;
 }
 
@@ -208,7 +1107,7 @@ int XSec::EnDesECB(const unsigned char* in, int in_size, unsigned char* out, boo
 }
 
 ////////////////////////////////////////////////////////////////////////
-/// DES ECBģʽ
+/// DES ECBģʽܣis_endʱȥPKCS7䲻Է-1
 int XSec::DeDesECB(const unsigned char* in, int in_size, unsigned char* out, bool is_end)
 {
 	for (int i = 0; i < in_size; i += block_size_)
@@ -221,8 +1120,8 @@ int XSec::DeDesECB(const unsigned char* in, int in_size, unsigned char* out, boo
 		);
 	}
 	if (is_end)
-		//PKCS7 һֽڴ洢Ĳֽ
-		return in_size - out[in_size - 1];
+		//PKCS7 һֽڴ洢Ĳֽ䲻Է-1
+		return UnPad(out, in_size, block_size_);
 	else
 		return in_size;
 }
@@ -265,12 +1164,12 @@ int XSec::EnDesCBC(const unsigned char* in, int in_size, unsigned char* out, boo
 }
 
 ////////////////////////////////////////////////////////////////////////
-/// DES CBCģʽ
+/// DES CBCģʽܣis_endʱȥPKCS7䲻Է-1
 int XSec::DeDesCBC(const unsigned char* in, int in_size, unsigned char* out, bool is_end)
 {
 	DES_ncbc_encrypt(in, out, in_size, &ks_, (DES_cblock*)iv_, DES_DECRYPT);
 	if (is_end)
-		return in_size - out[in_size - 1];
+		return UnPad(out, in_size, block_size_);
 	else
 		return in_size;
 }
\ No newline at end of file
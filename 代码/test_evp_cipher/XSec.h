@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <openssl/des.h>
 enum XSecType
 {
@@ -14,11 +15,48 @@ enum XSecType
 	XAES256_ECB,
 	XAES256_CBC,
 	XSM4_ECB,
-	XSM4_CBC
+	XSM4_CBC,
+	XAES128_CTR,
+	XAES192_CTR,
+	XAES256_CTR,
+	XSM4_CTR,
+	XAES128_GCM,
+	XAES192_GCM,
+	XAES256_GCM,
+	XSM4_GCM,
+	XCHACHA20_POLY1305
 };
+
+//AEADģʽ֤ǩֽ
+#define XSEC_TAG_SIZE 16
+//ӽܵһ¼
+struct XSecRecord
+{
+	//
+	const unsigned char* in = nullptr;
+
+	//ݴС
+	int in_size = 0;
+
+	//ݣʱin_size+СԺinͬ
+	unsigned char* out = nullptr;
+
+	//¼ivNULLʹInitʱivֻECB CBC
+	//CTRAEADģʽÿ¼ԼivΪNULLļ¼ʧܣout_sizeΪ0
+	const unsigned char* iv = nullptr;
+
+	//AEADģʽ֤ǩʱʱ룬XSEC_TAG_SIZEֽ
+	unsigned char* tag = nullptr;
+
+	//ӽܺݴСʧΪ0
+	int out_size = 0;
+};
+
 /*
 XSec sec;
 sec.Init(SDES_ECB,"12345678",true)
+int len = sec.Update(buf, size, buf);	//Сԭؼܣbufsize+С
+len = sec.Final(buf);
 */
 class XSec
 {
@@ -28,26 +66,119 @@ public:
 	/// @para type 
 	/// @para pass ԿǶ
 	/// @is_en true  false
+	/// @para iv ʼDESΪ8ֽڣAEADģʽΪ12ֽnonceΪС
+	///		  ECB CBCΪNULLȫ0CTRAEADģʽΪNULLֻԿӽǰResetnonce
+	///		  CTRAEADģʽͬһԿÿϢnonceظ
 	/// @return Ƿɹ
-	virtual bool Init(XSecType type, const std::string& pass, bool is_en);
+	/// ͬ+Կ+Կչᱻ棬ٴInitֻ
+	virtual bool Init(XSecType type, const std::string& pass, bool is_en, const unsigned char* iv = nullptr);
+
+	/////////////////////////////////////////////////////////////////
+	/// ʼµϢԿֻivInitһԿչ
+	/// @para iv ʼͬInitECB CBCΪNULLȫ0
+	/// @return ǷɹCTRAEADģʽivΪNULLfalse
+	virtual bool Reset(const unsigned char* iv = nullptr);
 
 	/////////////////////////////////////////////////////////////////
 	/// ӽ
 	/// @para in 
 	/// @para in_size ݴС
-	/// @para out 
+	/// @para out ݣʱin_size+СԺinͬԭؼӽܣ
+	/// @para is_end һݣfalseͬUpdatetrueͬUpdate+Final
 	/// @return ɹؼӽֽܺڴСʧܷ0
+	///		    AEADģʽܱǩУʧܷ0ʽʱ֮ǰҲ
 	virtual int Encrypt(const unsigned char* in, int in_size, unsigned char* out, bool is_end = true);
 
+	/////////////////////////////////////////////////////////////////
+	/// ӽСݣһβڶڲ´εʱ
+	/// ʱһFinalȥPKCS7
+	/// @para in 
+	/// @para in_size ݴС
+	/// @para out ݣin_size+СԺinͬԭؼӽܣ
+	/// @return ɹֽݲһʱΪ0ʧܷ-1
+	virtual int Update(const unsigned char* in, int in_size, unsigned char* out);
+
+	/////////////////////////////////////////////////////////////////
+	/// ӽܣڲʣ
+	/// ʱPKCS7ʱȥPKCS7AEADģʽɱǩУǩ
+	/// @para out ݣС
+	/// @return ɹֽʧܣAEADǩУʧܣ-1
+	virtual int Final(unsigned char* out);
+
+	/////////////////////////////////////////////////////////////////
+	/// ӽܶС¼ÿ¼PKCS7ʹԼiv
+	/// ECBCTRģʽѶ¼ϲһεãAES-NIˮ
+	/// ģʽֻһ䷽ʽظʼԿ
+	/// ú״̬ȷٵEncrypt UpdateǰReset
+	/// CTRAEADģʽivΪNULLļ¼¼nonce
+	/// @para records ¼飬дoutout_size
+	/// @para count ¼
+	/// @return ɹļ¼
+	virtual int EncryptBatch(XSecRecord* records, int count);
+
+	/////////////////////////////////////////////////////////////////
+	/// AEADģʽ֤ݣֻ֤ܣEncrypt֮ǰ
+	/// @return AEADģʽûnonceʧܷfalse
+	virtual bool SetAAD(const unsigned char* aad, int aad_size);
+
+	/////////////////////////////////////////////////////////////////
+	/// AEADģʽɣis_end=trueȡ֤ǩ
+	/// @para tag XSEC_TAG_SIZEֽ
+	/// @return AEADģʽδɼܷfalse
+	virtual bool GetTag(unsigned char* tag);
+
+	/////////////////////////////////////////////////////////////////
+	/// AEADģʽʱ֤ǩһEncrypt֮ǰ
+	/// @para tag XSEC_TAG_SIZEֽ
+	/// @return AEADģʽʧܷfalse
+	virtual bool SetTag(const unsigned char* tag);
+
+	/////////////////////////////////////////////////////////////////
+	/// ̷ֿ߳ӽܣECBCTRģʽCBCܸ黥̳߳вд
+	/// ģʽCBCܣ˻ΪEncrypt
+	/// һin_sizeǷСCTRCBCivڶεü
+	/// ͬһݲҪEncrypt Update
+	/// @para in 
+	/// @para in_size ݴС
+	/// @para out ݣʱin_size+СԺinͬ
+	/// @para is_end һݣһֿϴPKCS7
+	/// @return ɹؼӽֽܺڴСʧܷ0
+	virtual int ParallelEncrypt(const unsigned char* in, int in_size, unsigned char* out, bool is_end = true);
+
 	virtual void close();
 
+	//ݿС СģʽCTR AEADΪ1
+	int block_size() { return block_size_; }
+
+	//ivֽECBΪ0DES CBCΪ8AEADģʽΪ12Ϊ16
+	int iv_size() { return iv_size_; }
+
+	/////////////////////////////////////////////////////////////////
+	/// ǷAEADģʽGCMChaCha20-Poly1305֤ǩУǩ
+	static bool IsAEAD(XSecType type);
+
+	/////////////////////////////////////////////////////////////////
+	/// ԿĻ沢еԿ
+	static void ClearCache();
+
+	/////////////////////////////////////////////////////////////////
+	/// DESǷʹEVP鴦ĬtrueֻӰ֮Init
+	/// EVPҪOpenSSL 3.0legacy providerʧʱʹDES_ecb_encrypt鴦
+	/// legacy providerֻصXSec˽еOSSL_LIB_CTXУӰȫֿõ㷨
+	static void SetEvpDes(bool use);
+
+	virtual ~XSec() { close(); }
+
 private:
+	//״̬Ķ´Init
+	void Clear();
+
 	//////////////////////////////////////////////////////////////////
 	/// DES ECBģʽ
 	int EnDesECB(const unsigned char* in, int in_size, unsigned char* out, bool is_end);
 
 	////////////////////////////////////////////////////////////////////////
-	/// DES ECBģʽ
+	/// DES ECBģʽܣis_endʱȥPKCS7䲻Է-1
 	int DeDesECB(const unsigned char* in, int in_size, unsigned char* out, bool is_end);
 
 	//////////////////////////////////////////////////////////////////
@@ -55,12 +186,34 @@ private:
 	int EnDesCBC(const unsigned char* in, int in_size, unsigned char* out, bool is_end);
 
 	////////////////////////////////////////////////////////////////////////
-	/// DES CBCģʽ
+	/// DES CBCģʽܣis_endʱȥPKCS7䲻Է-1
 	int DeDesCBC(const unsigned char* in, int in_size, unsigned char* out, bool is_end);
 
+	//////////////////////////////////////////////////////////////////
+	/// ӽܰݣ
+	/// @return ֽʧܷ-1
+	int UpdateBlocks(const unsigned char* in, int in_size, unsigned char* out);
+
+	//////////////////////////////////////////////////////////////////
+	/// һֿ飬ʹõǰ߳Լ
+	/// @para iv ֿĳʼECBģʽ
+	/// @return ֽʧܷ-1
+	int EncryptChunk(const unsigned char* in, int in_size, unsigned char* out, const unsigned char* iv, bool is_last);
+
+	//////////////////////////////////////////////////////////////////
+	/// ECBм¼ƴһһμӽ
+	int BatchECB(XSecRecord* records, int count);
+
+	//////////////////////////////////////////////////////////////////
+	/// CTRм¼ļƴһECBԿ
+	int BatchCTR(XSecRecord* records, int count);
+
 	//DES㷨Կ
 	DES_key_schedule ks_;
 
+	//DESûEVPʹks_鴦
+	bool des_ks_ = false;
+
 	//㷨
 	XSecType type_;
 
@@ -70,10 +223,41 @@ private:
 	//ݿС С
 	int block_size_ = 0;
 
-	//ʼ
+	//ivֽ
+	int iv_size_ = 0;
+
+	//ivCTRAEADģʽûnonceʱܼӽ
+	bool has_iv_ = false;
+
+	//ʼCBCнʱϴεõһķ
 	unsigned char iv_[128] = { 0 };
 
+	//ȫԿֿ鲢ʱÿ߳ʼԼ
+	unsigned char key_[32] = { 0 };
+
+	//EVPӽ㷨 EVP_CIPHER
+	const void* cipher_ = 0;
+
+	//CTRģʽѴķParallelEncryptεʱ
+	long long ctr_blocks_ = 0;
+
+	//AEADģʽɵ֤ǩ
+	unsigned char tag_[XSEC_TAG_SIZE] = { 0 };
+
+	//AEADģʽɣǩ
+	bool has_tag_ = false;
+
 	//ӽ
 	void* ctx_ = 0;
+
+	//CTRԿõECB
+	void* ecb_ctx_ = 0;
+
+	//ʱƴӼ¼Ļ
+	std::vector<unsigned char> batch_buf_;
+
+	//UpdateʣĲһݣʱһ
+	unsigned char tail_[32] = { 0 };
+	int tail_size_ = 0;
 };
 
@@ -0,0 +1,988 @@
+#include "XSeekFile.h"
+#include "XThreadPool.h"
+#include <openssl/rand.h>
+#include <functional>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#include <cerrno>
+#ifdef __has_include
+#if __has_include(<zstd.h>)
+#define XSEEK_ZSTD_ENABLE
+#include <zstd.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "libzstd.lib")
+#endif
+#endif
+#if __has_include(<lz4.h>)
+#define XSEEK_LZ4_ENABLE
+#include <lz4.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "liblz4.lib")
+#endif
+#endif
+#endif
+using namespace std;
+
+#define XSEEK_VERSION 2
+#define XSEEK_HEAD_SIZE 32
+#define XSEEK_ENTRY_SIZE (8 + 4 + 16 + XSEC_TAG_SIZE)
+#define XSEEK_TAIL_SIZE 16
+
+//ļͷmagic"XSCK" (4) ļС(8) ԿУֵ(16) ļͷ(32)֮
+#define XSEEK_CKPT_HEAD_SIZE (32 + XSEEK_HEAD_SIZE)
+
+//ӵֽ
+#define XSEEK_PAD_MAX 32
+
+//zstdѹ1죬ͼٶ൱
+#define XSEEK_ZSTD_LEVEL 1
+
+static void PutU16(unsigned char* p, unsigned int v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+}
+
+static void PutU32(unsigned char* p, unsigned int v)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = (v >> (i * 8)) & 0xff;
+}
+
+static void PutU64(unsigned char* p, unsigned long long v)
+{
+	for (int i = 0; i < 8; i++)
+		p[i] = (v >> (i * 8)) & 0xff;
+}
+
+static unsigned int GetU16(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static unsigned int GetU32(const unsigned char* p)
+{
+	unsigned int v = 0;
+	for (int i = 3; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static unsigned long long GetU64(const unsigned char* p)
+{
+	unsigned long long v = 0;
+	for (int i = 7; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+//ļضϵָС
+static bool ResizeFile(const string& filename, long long size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER pos;
+	pos.QuadPart = size;
+	bool re = SetFilePointerEx(file, pos, NULL, FILE_BEGIN) && SetEndOfFile(file);
+	CloseHandle(file);
+	return re;
+#else
+	return truncate(filename.c_str(), size) == 0;
+#endif
+}
+
+//ļдˢ̣ofstreamflushֻϵͳ棬ϵᶪ
+static bool SyncFile(const string& filename)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_EXISTING, 0, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	bool re = FlushFileBuffers(file) != 0;
+	CloseHandle(file);
+	return re;
+#else
+	int fd = open(filename.c_str(), O_WRONLY);
+	if (fd < 0)
+		return false;
+	bool re = fsync(fd) == 0;
+	close(fd);
+	return re;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////
+/// ʱǷѹ㷨Ŀ
+bool XSeekFile::IsCodecSupported(XCodec codec)
+{
+	switch (codec)
+	{
+	case XCODEC_NONE:
+		return true;
+#ifdef XSEEK_ZSTD_ENABLE
+	case XCODEC_ZSTD:
+		return true;
+#endif
+#ifdef XSEEK_LZ4_ENABLE
+	case XCODEC_LZ4:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+//ѹһ
+//@return ѹĴСܱС0
+static int Compress(XCodec codec, void* zctx, const unsigned char* in, int in_size, unsigned char* out, int out_max)
+{
+	//ʱûѹķ֧ʹò
+	(void)zctx; (void)in; (void)in_size; (void)out; (void)out_max;
+	switch (codec)
+	{
+#ifdef XSEEK_ZSTD_ENABLE
+	case XCODEC_ZSTD:
+	{
+		size_t re = ZSTD_compressCCtx((ZSTD_CCtx*)zctx, out, out_max, in, in_size, XSEEK_ZSTD_LEVEL);
+		if (ZSTD_isError(re))
+			return 0;
+		return (int)re;
+	}
+#endif
+#ifdef XSEEK_LZ4_ENABLE
+	case XCODEC_LZ4:
+		return LZ4_compress_default((const char*)in, (char*)out, in_size, out_max);
+#endif
+	default:
+		return 0;
+	}
+}
+
+//ѹһݣѹout_sizeֽ
+static bool Decompress(XCodec codec, const unsigned char* in, int in_size, unsigned char* out, int out_size)
+{
+	(void)in; (void)in_size; (void)out; (void)out_size;
+	switch (codec)
+	{
+#ifdef XSEEK_ZSTD_ENABLE
+	case XCODEC_ZSTD:
+		return ZSTD_decompress(out, out_size, in, in_size) == (size_t)out_size;
+#endif
+#ifdef XSEEK_LZ4_ENABLE
+	case XCODEC_LZ4:
+		return LZ4_decompress_safe((const char*)in, (char*)out, in_size, out_size) == out_size;
+#endif
+	default:
+		return false;
+	}
+}
+
+XSeekFile::~XSeekFile()
+{
+	Close();
+#ifdef XSEEK_ZSTD_ENABLE
+	ZSTD_freeCCtx((ZSTD_CCtx*)zctx_);
+#endif
+}
+
+//ļͷ
+void XSeekFile::MakeHead(unsigned char* head, long long size)
+{
+	memset(head, 0, XSEEK_HEAD_SIZE);
+	memcpy(head, "XSCF", 4);
+	PutU16(head + 4, XSEEK_VERSION);
+	PutU16(head + 6, type_);
+	PutU32(head + 8, chunk_size_);
+	PutU16(head + 12, codec_);
+	PutU64(head + 16, size);
+	memcpy(head + 24, salt_, sizeof(salt_));
+}
+
+//ļͷʧܷfalse
+bool XSeekFile::ParseHead(const unsigned char* head)
+{
+	if (memcmp(head, "XSCF", 4) != 0 || GetU16(head + 4) != XSEEK_VERSION)
+		return false;
+	type_ = (XSecType)GetU16(head + 6);
+	chunk_size_ = (int)GetU32(head + 8);
+	codec_ = (XCodec)GetU16(head + 12);
+	size_ = (long long)GetU64(head + 16);
+	memcpy(salt_, head + 24, sizeof(salt_));
+	is_aead_ = XSec::IsAEAD(type_);
+	return chunk_size_ > 0 && chunk_size_ <= XSEEK_CHUNK_MAX && size_ >= 0 && IsCodecSupported(codec_);
+}
+
+//дõĻ
+bool XSeekFile::InitWrite()
+{
+#ifdef XSEEK_ZSTD_ENABLE
+	if (codec_ == XCODEC_ZSTD && !zctx_)
+		zctx_ = ZSTD_createCCtx();
+	if (codec_ == XCODEC_ZSTD && !zctx_)
+		return false;
+#endif
+	buf_.resize(chunk_size_);
+	buf_size_ = 0;
+	out_.resize(chunk_size_ + XSEEK_PAD_MAX + 1);
+	if (codec_ != XCODEC_NONE)
+		zbuf_.resize(chunk_size_ + 1);
+	return true;
+}
+
+//ԿУֵȫ0ivһȫ0飬ͬԿõͬ
+bool XSeekFile::KeyCheck(unsigned char* check)
+{
+	unsigned char iv[16] = { 0 };
+	unsigned char zero[16] = { 0 };
+	unsigned char out[16 + XSEEK_PAD_MAX] = { 0 };
+	if (!sec_.Reset(iv))
+		return false;
+	if (sec_.Encrypt(zero, sizeof(zero), out, true) < 16)
+		return false;
+	memcpy(check, out, 16);
+	return true;
+}
+
+//ļдļͷ
+bool XSeekFile::CreateCheckpoint()
+{
+	unsigned char head[XSEEK_CKPT_HEAD_SIZE] = { 0 };
+	memcpy(head, "XSCK", 4);
+	PutU64(head + 8, src_size_);
+	if (!KeyCheck(head + 16))
+		return false;
+	MakeHead(head + 32, 0);
+	ofstream ofs(filename_ + ".ckpt", ios::binary);
+	ofs.write((char*)head, XSEEK_CKPT_HEAD_SIZE);
+	ckpt_count_ = 0;
+	return (bool)ofs;
+}
+
+//ˢļдֿ׷ӵļ
+//Ȱͬдͬļϵļеķֿļһ
+bool XSeekFile::Checkpoint()
+{
+	ofs_.flush();
+	if (!ofs_)
+		return false;
+	int count = (int)index_.size() - ckpt_count_;
+	if (count <= 0)
+		return true;
+	if (!SyncFile(filename_))
+		return false;
+	vector<unsigned char> entries((size_t)count * XSEEK_ENTRY_SIZE);
+	unsigned char* p = entries.data();
+	for (int i = ckpt_count_; i < (int)index_.size(); i++)
+	{
+		Chunk& c = index_[i];
+		PutU64(p, c.offset);
+		PutU32(p + 8, c.size);
+		memcpy(p + 12, c.iv, sizeof(c.iv));
+		memcpy(p + 28, c.tag, XSEC_TAG_SIZE);
+		p += XSEEK_ENTRY_SIZE;
+	}
+	ofstream ofs(filename_ + ".ckpt", ios::binary | ios::app);
+	ofs.write((char*)entries.data(), entries.size());
+	ofs.close();
+	if (!ofs || !SyncFile(filename_ + ".ckpt"))
+		return false;
+	ckpt_count_ = (int)index_.size();
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ӽļָжϵд
+bool XSeekFile::Resume(std::string filename, std::string pass)
+{
+	Close();
+	index_.clear();
+	ifstream ifs(filename + ".ckpt", ios::binary);
+	if (!ifs)
+		return false;
+	ifs.seekg(0, ios::end);
+	long long ckpt_size = ifs.tellg();
+	if (ckpt_size < XSEEK_CKPT_HEAD_SIZE)
+		return false;
+	unsigned char head[XSEEK_CKPT_HEAD_SIZE];
+	ifs.seekg(0);
+	ifs.read((char*)head, XSEEK_CKPT_HEAD_SIZE);
+	if (!ifs || memcmp(head, "XSCK", 4) != 0 || !ParseHead(head + 32))
+		return false;
+	if (!sec_.Init(type_, pass, true))
+		return false;
+	unsigned char check[16];
+	if (!KeyCheck(check) || memcmp(check, head + 16, sizeof(check)) != 0)
+		return false;
+	src_size_ = (long long)GetU64(head + 8);
+
+	//һֻдһ֣
+	long long count = (ckpt_size - XSEEK_CKPT_HEAD_SIZE) / XSEEK_ENTRY_SIZE;
+	vector<unsigned char> entries((size_t)count * XSEEK_ENTRY_SIZE);
+	if (count > 0)
+		ifs.read((char*)entries.data(), entries.size());
+	if (!ifs)
+		return false;
+	ifs.close();
+	index_.resize(count);
+	long long pos = XSEEK_HEAD_SIZE;
+	const unsigned char* p = entries.data();
+	for (auto& c : index_)
+	{
+		c.offset = (long long)GetU64(p);
+		c.size = (int)GetU32(p + 8);
+		memcpy(c.iv, p + 12, sizeof(c.iv));
+		memcpy(c.tag, p + 28, XSEC_TAG_SIZE);
+		p += XSEEK_ENTRY_SIZE;
+		if (c.offset != pos || c.size <= 0 || c.size > chunk_size_ + XSEEK_PAD_MAX + 1)
+		{
+			index_.clear();
+			return false;
+		}
+		pos += c.size;
+	}
+
+	//ļضϵ󱣴ķֿ飬֮жʱûбȵķֿ
+	ifs.open(filename, ios::binary);
+	if (!ifs)
+	{
+		index_.clear();
+		return false;
+	}
+	ifs.seekg(0, ios::end);
+	long long file_size = ifs.tellg();
+	ifs.close();
+	if (file_size < pos || !ResizeFile(filename, pos)
+		|| !ResizeFile(filename + ".ckpt", XSEEK_CKPT_HEAD_SIZE + count * XSEEK_ENTRY_SIZE))
+	{
+		index_.clear();
+		return false;
+	}
+
+	//ֻдķֿ󱣴
+	size_ = count * chunk_size_;
+	pass_ = pass;
+	filename_ = filename;
+	if (!InitWrite())
+		return false;
+	ofs_.open(filename, ios::binary | ios::in | ios::out);
+	if (!ofs_)
+		return false;
+	ofs_.seekp(pos);
+	pos_ = pos;
+	ckpt_count_ = (int)count;
+	ckpt_size_ = size_;
+	if (ckpt_interval_ <= 0)
+		ckpt_interval_ = XSEEK_CKPT_INTERVAL;
+	is_write_ = true;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ļдļͷ
+/// ĴСCloseʱ֪д0Closeʱ
+bool XSeekFile::Create(std::string filename, XSecType type, std::string pass, int chunk_size, XCodec codec)
+{
+	Close();
+	if (chunk_size <= 0 || chunk_size > XSEEK_CHUNK_MAX || !IsCodecSupported(codec))
+		return false;
+	if (!sec_.Init(type, pass, true))
+		return false;
+	type_ = type;
+	pass_ = pass;
+	is_aead_ = XSec::IsAEAD(type);
+	chunk_size_ = chunk_size;
+	codec_ = codec;
+	size_ = 0;
+	index_.clear();
+	if (RAND_bytes(salt_, sizeof(salt_)) != 1)
+		return false;
+	if (!InitWrite())
+		return false;
+
+	ofs_.open(filename, ios::binary);
+	if (!ofs_)
+		return false;
+	unsigned char head[XSEEK_HEAD_SIZE];
+	MakeHead(head, size_);
+	ofs_.write((char*)head, XSEEK_HEAD_SIZE);
+	if (!ofs_)
+	{
+		ofs_.close();
+		return false;
+	}
+	pos_ = XSEEK_HEAD_SIZE;
+	filename_ = filename;
+	if (ckpt_interval_ > 0)
+	{
+		ckpt_size_ = 0;
+		if (!CreateCheckpoint())
+		{
+			ofs_.close();
+			return false;
+		}
+	}
+	is_write_ = true;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ʽļļļͷֱдܴС
+bool XSeekFile::Create(XSeekSink sink, long long size, XSecType type, std::string pass, int chunk_size, XCodec codec)
+{
+	Close();
+	if (!sink || size < 0 || chunk_size <= 0 || chunk_size > XSEEK_CHUNK_MAX || !IsCodecSupported(codec))
+		return false;
+	if (!sec_.Init(type, pass, true))
+		return false;
+	type_ = type;
+	pass_ = pass;
+	is_aead_ = XSec::IsAEAD(type);
+	chunk_size_ = chunk_size;
+	codec_ = codec;
+	size_ = 0;
+	index_.clear();
+	if (RAND_bytes(salt_, sizeof(salt_)) != 1)
+		return false;
+	if (!InitWrite())
+		return false;
+	unsigned char head[XSEEK_HEAD_SIZE];
+	MakeHead(head, size);
+	if (!sink(head, XSEEK_HEAD_SIZE))
+		return false;
+	sink_ = sink;
+	sink_size_ = size;
+	ckpt_interval_ = 0;
+	pos_ = XSEEK_HEAD_SIZE;
+	is_write_ = true;
+	return true;
+}
+
+//дļsink
+bool XSeekFile::Output(const unsigned char* data, long long size)
+{
+	if (sink_)
+		return sink_(data, size);
+	ofs_.write((const char*)data, size);
+	return (bool)ofs_;
+}
+
+//һֿ鲢д
+bool XSeekFile::WriteChunk(const unsigned char* data, int size, bool is_last)
+{
+	Chunk c;
+	if (RAND_bytes(c.iv, sizeof(c.iv)) != 1)
+		return false;
+	if (!sec_.Reset(c.iv))
+		return false;
+	if (is_aead_)
+	{
+		//ļͷĴСûȷ֤ʱ0
+		//һǣصĩβķֿٸļͷСͷֿµһ֤ʧ
+		unsigned char aad[XSEEK_HEAD_SIZE + 5];
+		MakeHead(aad, 0);
+		PutU32(aad + XSEEK_HEAD_SIZE, (unsigned int)index_.size());
+		aad[XSEEK_HEAD_SIZE + 4] = is_last ? 1 : 0;
+		if (!sec_.SetAAD(aad, sizeof(aad)))
+			return false;
+	}
+
+	//ѹǰһֽڱǷѹѹܱСĿԭ
+	const unsigned char* in = data;
+	int in_size = size;
+	if (codec_ != XCODEC_NONE)
+	{
+		int zsize = Compress(codec_, zctx_, data, size, zbuf_.data() + 1, size - 1);
+		if (zsize > 0)
+		{
+			zbuf_[0] = 1;
+		}
+		else
+		{
+			zbuf_[0] = 0;
+			memcpy(zbuf_.data() + 1, data, size);
+			zsize = size;
+		}
+		in = zbuf_.data();
+		in_size = zsize + 1;
+	}
+	int len = sec_.Encrypt(in, in_size, out_.data(), true);
+	if (len <= 0)
+		return false;
+	if (is_aead_ && !sec_.GetTag(c.tag))
+		return false;
+	if (!Output(out_.data(), len))
+		return false;
+	c.offset = pos_;
+	c.size = len;
+	pos_ += len;
+	size_ += size;
+	index_.push_back(c);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ׷ģһֿͼд
+bool XSeekFile::Write(const unsigned char* data, long long size)
+{
+	if (!is_write_)
+		return false;
+	//ǷһҪȺ滹ݻCloseʱ֪дĻ
+	while (size > 0)
+	{
+		if (buf_size_ == chunk_size_)
+		{
+			//滹ݣĲһ
+			if (!WriteChunk(buf_.data(), buf_size_, false))
+				return false;
+			buf_size_ = 0;
+		}
+		else if (buf_size_ == 0 && size > chunk_size_)
+		{
+			//ΪʱֱӼܣ
+			if (!WriteChunk(data, chunk_size_, false))
+				return false;
+			data += chunk_size_;
+			size -= chunk_size_;
+		}
+		else
+		{
+			int len = chunk_size_ - buf_size_;
+			if (len > size)
+				len = (int)size;
+			memcpy(buf_.data() + buf_size_, data, len);
+			buf_size_ += len;
+			data += len;
+			size -= len;
+			continue;
+		}
+
+		//һCloseд룬ȣָʱдĶҲһ
+		if (ckpt_interval_ > 0 && size_ - ckpt_size_ >= ckpt_interval_)
+		{
+			if (!Checkpoint())
+				return false;
+			ckpt_size_ = size_;
+		}
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////
+/// дʱʣݲдȡʱرļ
+bool XSeekFile::Close()
+{
+	if (ifs_.is_open())
+		ifs_.close();
+	if (!is_write_)
+		return true;
+	is_write_ = false;
+
+	bool is_ok = true;
+	if (buf_size_ > 0)
+		is_ok = WriteChunk(buf_.data(), buf_size_, true);
+	buf_size_ = 0;
+
+	//ʽļͷѾдĴСһ
+	if (sink_ && size_ != sink_size_)
+		is_ok = false;
+
+	//ͽβ
+	if (is_ok)
+	{
+		vector<unsigned char> entries(index_.size() * XSEEK_ENTRY_SIZE + XSEEK_TAIL_SIZE);
+		unsigned char* p = entries.data();
+		for (auto& c : index_)
+		{
+			PutU64(p, c.offset);
+			PutU32(p + 8, c.size);
+			memcpy(p + 12, c.iv, sizeof(c.iv));
+			memcpy(p + 28, c.tag, XSEC_TAG_SIZE);
+			p += XSEEK_ENTRY_SIZE;
+		}
+		PutU64(p, pos_);
+		PutU32(p + 8, (unsigned int)index_.size());
+		memcpy(p + 12, "XSCI", 4);
+		is_ok = Output(entries.data(), entries.size());
+
+		//ĴС
+		if (is_ok && !sink_)
+		{
+			unsigned char head[XSEEK_HEAD_SIZE];
+			MakeHead(head, size_);
+			ofs_.seekp(0);
+			ofs_.write((char*)head, XSEEK_HEAD_SIZE);
+			if (!ofs_)
+				is_ok = false;
+		}
+	}
+	buf_.clear();
+	buf_.shrink_to_fit();
+	zbuf_.clear();
+	zbuf_.shrink_to_fit();
+	if (sink_)
+	{
+		sink_ = nullptr;
+		return is_ok;
+	}
+	ofs_.close();
+	if (is_ok && ckpt_interval_ > 0)
+		remove((filename_ + ".ckpt").c_str());
+	if (!is_ok && ckpt_interval_ <= 0)
+		remove(filename_.c_str());
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// 򿪼ļȡļͷ
+bool XSeekFile::Open(std::string filename, std::string pass)
+{
+	Close();
+	index_.clear();
+	size_ = 0;
+	ifs_.open(filename, ios::binary);
+	if (!ifs_)
+		return false;
+	ifs_.seekg(0, ios::end);
+	long long file_size = ifs_.tellg();
+	if (file_size < XSEEK_HEAD_SIZE + XSEEK_TAIL_SIZE)
+	{
+		Close();
+		return false;
+	}
+
+	unsigned char head[XSEEK_HEAD_SIZE];
+	unsigned char tail[XSEEK_TAIL_SIZE];
+	ifs_.seekg(0);
+	ifs_.read((char*)head, XSEEK_HEAD_SIZE);
+	ifs_.seekg(file_size - XSEEK_TAIL_SIZE);
+	ifs_.read((char*)tail, XSEEK_TAIL_SIZE);
+	if (!ifs_ || memcmp(tail + 12, "XSCI", 4) != 0 || !ParseHead(head))
+	{
+		Close();
+		return false;
+	}
+	long long index_offset = (long long)GetU64(tail);
+	long long count = GetU32(tail + 8);
+
+	//ֿλҪļͷһ
+	bool is_ok = count == (size_ + chunk_size_ - 1) / chunk_size_
+		&& index_offset >= XSEEK_HEAD_SIZE
+		&& index_offset + count * XSEEK_ENTRY_SIZE + XSEEK_TAIL_SIZE == file_size;
+	if (is_ok)
+		is_ok = sec_.Init(type_, pass, false);
+	if (!is_ok)
+	{
+		Close();
+		return false;
+	}
+	pass_ = pass;
+
+	vector<unsigned char> entries(count * XSEEK_ENTRY_SIZE);
+	ifs_.seekg(index_offset);
+	if (count > 0)
+		ifs_.read((char*)entries.data(), entries.size());
+	if (!ifs_)
+	{
+		Close();
+		return false;
+	}
+	index_.resize(count);
+	long long pos = XSEEK_HEAD_SIZE;
+	const unsigned char* p = entries.data();
+	for (auto& c : index_)
+	{
+		c.offset = (long long)GetU64(p);
+		c.size = (int)GetU32(p + 8);
+		memcpy(c.iv, p + 12, sizeof(c.iv));
+		memcpy(c.tag, p + 28, XSEC_TAG_SIZE);
+		p += XSEEK_ENTRY_SIZE;
+
+		//ֿ鰴˳
+		if (c.offset != pos || c.size <= 0 || c.size > chunk_size_ + XSEEK_PAD_MAX + 1)
+		{
+			index_.clear();
+			Close();
+			return false;
+		}
+		pos += c.size;
+	}
+	if (pos != index_offset)
+	{
+		index_.clear();
+		Close();
+		return false;
+	}
+	return true;
+}
+
+//һֿ
+int XSeekFile::DecryptChunk(XSec& sec, int index, const unsigned char* in, unsigned char* out, unsigned char* tmp)
+{
+	Chunk& c = index_[index];
+	if (!sec.Reset(c.iv))
+		return -1;
+	if (is_aead_)
+	{
+		//ǰжϣдʱһ˵ĩβķֿ鱻ص׷˷ֿ
+		unsigned char aad[XSEEK_HEAD_SIZE + 5];
+		MakeHead(aad, 0);
+		PutU32(aad + XSEEK_HEAD_SIZE, index);
+		aad[XSEEK_HEAD_SIZE + 4] = index == (int)index_.size() - 1 ? 1 : 0;
+		if (!sec.SetAAD(aad, sizeof(aad)) || !sec.SetTag(c.tag))
+			return -1;
+	}
+
+	//һⶼ
+	long long want = size_ - (long long)index * chunk_size_;
+	if (want > chunk_size_)
+		want = chunk_size_;
+	if (codec_ == XCODEC_NONE)
+	{
+		int len = sec.Encrypt(in, c.size, out, true);
+		if (len != want)
+			return -1;
+		return len;
+	}
+
+	//һֽڱǷѹ
+	int len = sec.Encrypt(in, c.size, tmp, true);
+	if (len < 1)
+		return -1;
+	if (tmp[0] == 0)
+	{
+		if (len - 1 != want)
+			return -1;
+		memcpy(out, tmp + 1, want);
+		return (int)want;
+	}
+	if (tmp[0] != 1 || !Decompress(codec_, tmp + 1, len - 1, out, (int)want))
+		return -1;
+	return (int)want;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ȡλõģֻ漰ķֿ
+/// 漰ķֿļһζֿ̳߳вн
+long long XSeekFile::Read(long long pos, unsigned char* out, long long size)
+{
+	if (!ifs_.is_open() || pos < 0 || size < 0)
+		return -1;
+	if (pos >= size_ || size == 0)
+		return 0;
+	if (size > size_ - pos)
+		size = size_ - pos;
+	int first = (int)(pos / chunk_size_);
+	int last = (int)((pos + size - 1) / chunk_size_);
+	int count = last - first + 1;
+
+	long long begin = index_[first].offset;
+	long long end = index_[last].offset + index_[last].size;
+	vector<unsigned char> in(end - begin);
+	ifs_.clear();
+	ifs_.seekg(begin);
+	ifs_.read((char*)in.data(), in.size());
+	if (!ifs_)
+		return -1;
+
+	//ûÿȽܵʱ壬ٸҪĲ
+	//ѹʱҪһ黺Žܺδѹ
+	int buf_size = chunk_size_ + XSEEK_PAD_MAX + 1;
+	vector<unsigned char> bufs((size_t)buf_size * count);
+	vector<unsigned char> tmps(codec_ != XCODEC_NONE ? (size_t)buf_size * count : 0);
+	vector<int> results(count, -1);
+	auto decrypt = [&](XSec& sec, int i) {
+		int index = first + i;
+		unsigned char* tmp = tmps.empty() ? nullptr : tmps.data() + (size_t)buf_size * i;
+		results[i] = DecryptChunk(sec, index, in.data() + (index_[index].offset - begin),
+			bufs.data() + (size_t)buf_size * i, tmp);
+	};
+	if (count == 1)
+	{
+		decrypt(sec_, 0);
+	}
+	else
+	{
+		vector<function<void()> > tasks;
+		for (int i = 0; i < count; i++)
+		{
+			tasks.push_back([&, i] {
+				//Կչл棬ÿInitֻ
+				XSec sec;
+				if (sec.Init(type_, pass_, false))
+					decrypt(sec, i);
+			});
+		}
+		XThreadPool::Instance()->Run(tasks);
+	}
+
+	long long out_size = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (results[i] < 0)
+			return -1;
+		long long chunk_pos = (long long)(first + i) * chunk_size_;
+		long long from = pos > chunk_pos ? pos - chunk_pos : 0;
+		long long len = results[i] - from;
+		if (len > size - out_size)
+			len = size - out_size;
+		memcpy(out + out_size, bufs.data() + (size_t)buf_size * i + from, len);
+		out_size += len;
+	}
+	return out_size;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ͨļתΪֿļ
+bool XSeekFile::EncryptFile(std::string in_filename, std::string out_filename,
+	XSecType type, std::string pass, int chunk_size, XCodec codec, bool is_resume)
+{
+	ifstream ifs(in_filename, ios::binary);
+	if (!ifs)
+		return false;
+	ifs.seekg(0, ios::end);
+	long long in_size = ifs.tellg();
+	ifs.seekg(0);
+
+	//ļС˵ͬһļ¿ʼ
+	XSeekFile sf;
+	bool is_resumed = false;
+	if (is_resume)
+	{
+		sf.SetCheckpoint(XSEEK_CKPT_INTERVAL);
+		is_resumed = sf.Resume(out_filename, pass) && sf.src_size_ == in_size && sf.size() <= in_size;
+		if (is_resumed)
+		{
+			ifs.seekg(sf.size());
+		}
+		else
+		{
+			sf.is_write_ = false;
+			sf.ofs_.close();
+		}
+	}
+	sf.src_size_ = in_size;
+	if (!is_resumed && !sf.Create(out_filename, type, pass, chunk_size, codec))
+		return false;
+	vector<unsigned char> buf(1024 * 1024);
+	while (ifs)
+	{
+		ifs.read((char*)buf.data(), buf.size());
+		if (ifs.bad())
+			break;
+		if (ifs.gcount() > 0 && !sf.Write(buf.data(), ifs.gcount()))
+			break;
+	}
+	if (ifs.bad() || !ifs.eof())
+	{
+		//ʱļ´δжϴ
+		sf.is_write_ = false;
+		sf.ofs_.close();
+		if (!is_resume)
+			remove(out_filename.c_str());
+		return false;
+	}
+	return sf.Close();
+}
+
+/////////////////////////////////////////////////////////////////
+/// ѷֿļԭΪͨļ
+/// ÿζȡֿ飬̳߳внܺͽѹ
+bool XSeekFile::DecryptFile(std::string in_filename, std::string out_filename, std::string pass)
+{
+	XSeekFile sf;
+	if (!sf.Open(in_filename, pass))
+		return false;
+	ofstream ofs(out_filename, ios::binary);
+	if (!ofs)
+		return false;
+	long long step = (long long)sf.chunk_size() * XThreadPool::Instance()->thread_count();
+	if (step < 1024 * 1024)
+		step = (1024 * 1024 + sf.chunk_size() - 1) / sf.chunk_size() * sf.chunk_size();
+	vector<unsigned char> buf(step);
+	bool is_ok = true;
+	for (long long pos = 0; pos < sf.size(); pos += step)
+	{
+		long long len = sf.Read(pos, buf.data(), step);
+		if (len <= 0)
+		{
+			is_ok = false;
+			break;
+		}
+		ofs.write((char*)buf.data(), len);
+		if (!ofs)
+		{
+			is_ok = false;
+			break;
+		}
+	}
+	ofs.close();
+	if (!is_ok)
+		remove(out_filename.c_str());
+	return is_ok;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ѷֿļýշԿ¼ܣʽsink
+/// ̳ܰ߳вУܺڵ̣߳ͬʱֻռһڴ
+bool XSeekFile::Transcode(std::string in_filename, std::string pass,
+	XSecType out_type, std::string out_pass, XSeekSink sink, int batch)
+{
+	XSeekFile in;
+	if (!in.Open(in_filename, pass))
+		return false;
+	XSeekFile out;
+	if (!out.Create(sink, in.size(), out_type, out_pass, in.chunk_size(), in.codec()))
+		return false;
+	if (batch <= 0)
+		batch = XThreadPool::Instance()->thread_count();
+	if (batch <= 0)
+		batch = 1;
+	long long step = (long long)in.chunk_size() * batch;
+	vector<unsigned char> buf(step);
+	for (long long pos = 0; pos < in.size(); pos += step)
+	{
+		long long len = in.Read(pos, buf.data(), step);
+		if (len <= 0 || !out.Write(buf.data(), len))
+		{
+			//Ѿsinkʣݺ
+			out.is_write_ = false;
+			return false;
+		}
+	}
+	return out.Close();
+}
+
+/////////////////////////////////////////////////////////////////
+/// ļдEINTR
+XSeekSink XSeekFile::FdSink(int fd)
+{
+	return [fd](const unsigned char* data, long long size) {
+		while (size > 0)
+		{
+			int len = size > (1 << 30) ? (1 << 30) : (int)size;
+#ifdef _WIN32
+			int re = _write(fd, data, len);
+#else
+			int re = (int)write(fd, data, len);
+#endif
+			if (re < 0 && errno == EINTR)
+				continue;
+			if (re <= 0)
+				return false;
+			data += re;
+			size -= re;
+		}
+		return true;
+	};
+}
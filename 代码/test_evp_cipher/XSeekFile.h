@@ -0,0 +1,264 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include "XSec.h"
+
+//ĬϷֿСÿ鵥ܣȡʱ
+#define XSEEK_CHUNK_SIZE (64 * 1024)
+
+//ֿС
+#define XSEEK_CHUNK_MAX (64 * 1024 * 1024)
+
+//Ĭÿдıһν
+#define XSEEK_CKPT_INTERVAL (256LL * 1024 * 1024)
+
+//ѹ㷨ѹټ
+enum XCodec
+{
+	XCODEC_NONE,
+	XCODEC_ZSTD,	//ѹʸߣҪzstd
+	XCODEC_LZ4		//ٶȿ죬Ҫlz4
+};
+
+//ʽ˳ļݣԷرշfalse
+typedef std::function<bool(const unsigned char* data, long long size)> XSeekSink;
+
+/*
+ȡķֿļ
+ļͷmagic"XSCF" 汾(2) 㷨(2) ֿС(4) ѹ㷨(2) (2) ĴС(8) (8)32ֽ
+ֿ飺ÿĵܣCBC ECBPKCS7䣬ĴС̶
+	  ѹ㷨ʱÿѹܵΪ Ƿѹ(1) + ݣѹ󲻱СĿ鲻ѹ
+ÿһ ƫ(8) ĴС(4) iv(16) ǩ(16)
+βƫ(8) ֿ(4) magic"XSCI"
+СˣAEADģʽļͷֿźǷһ(1)Ϊ֤
+ֿ鲻ܵŲļҲܽص׷ӷֿ飻ûзֿĿļûп֤
+
+д
+XSeekFile sf;
+sf.Create("data.csv.xscf", XAES128_GCM, "1234567812345678", XSEEK_CHUNK_SIZE, XCODEC_ZSTD);
+sf.Write(data, size);
+sf.Close();
+
+жϺд룬ļΪļ.ckpt¼дֿ
+XSeekFile sf;
+sf.SetCheckpoint(XSEEK_CKPT_INTERVAL);
+if (!sf.Resume("data.csv.xscf", "1234567812345678"))
+	sf.Create("data.csv.xscf", XAES128_GCM, "1234567812345678");
+ifs.seekg(sf.size());
+...
+
+ʱļýշԿ¼ֱܺдsocket
+XSeekFile::Transcode("data.csv.xscf", "1234567812345678", XAES128_GCM, consumer_key, XSeekFile::FdSink(sock));
+
+ȡ
+XSeekFile sf;
+sf.Open("data.csv.xscf", "1234567812345678");
+sf.Read(pos, buf, size);
+*/
+class XSeekFile
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// ļдļͷ
+	/// @para filename ļ
+	/// @para type 㷨
+	/// @para pass Կ
+	/// @para chunk_size ֿĴС1ֽڵXSEEK_CHUNK_MAX
+	/// @para codec ѹ㷨ʱûжӦĿⷵfalse
+	/// @return ɹtrue
+	bool Create(std::string filename, XSecType type, std::string pass,
+		int chunk_size = XSEEK_CHUNK_SIZE, XCodec codec = XCODEC_NONE);
+
+	/////////////////////////////////////////////////////////////////
+	/// ʽļļݰ˳򽻸sinkͷ޸ļͷֱsocketܵ
+	/// ֱ֧
+	/// @para sink 
+	/// @para size ܴСдļͷCloseǰдıô
+	/// @return ɹtrue
+	bool Create(XSeekSink sink, long long size, XSecType type, std::string pass,
+		int chunk_size = XSEEK_CHUNK_SIZE, XCodec codec = XCODEC_NONE);
+
+	/////////////////////////////////////////////////////////////////
+	/// ñȵļCreateResumeǰ
+	/// ÿдintervalֽģȰˢļٰ·ֿ׷ӵļ
+	/// ֿ֮ûʽ״̬ǻָҪȫ״̬
+	/// @para interval ֽСڵ0ȣĬϣ
+	void SetCheckpoint(long long interval) { ckpt_interval_ = interval; }
+
+	/////////////////////////////////////////////////////////////////
+	/// ӽļָжϵд룬ļضϵ󱣴ķֿ飬֮Write
+	/// size()ȡûýȼʱXSEEK_CKPT_INTERVAL
+	/// @para filename жϵļ
+	/// @para pass Կжǰͬ
+	/// @return ûнļʽԿͬfalse
+	bool Resume(std::string filename, std::string pass);
+
+	/////////////////////////////////////////////////////////////////
+	/// ׷ģһֿͼд
+	/// @return ʧܷfalse
+	bool Write(const unsigned char* data, long long size);
+
+	/////////////////////////////////////////////////////////////////
+	/// 򿪼ļȡļͷ
+	/// @para filename ļ
+	/// @para pass Կ
+	/// @return ʽԿӦ㷨ַ֧false
+	bool Open(std::string filename, std::string pass);
+
+	/////////////////////////////////////////////////////////////////
+	/// ȡλõģֻ漰ķֿ飬ֿ̳߳внܺͽѹ
+	/// @para pos ƫ
+	/// @para out 壬sizeֽ
+	/// @para size ȡСļĩβĲֲ
+	/// @return ȡֽļʧܡʧܻǩУʧܷ-1
+	long long Read(long long pos, unsigned char* out, long long size);
+
+	/////////////////////////////////////////////////////////////////
+	/// дʱʣݲдɹɾļȡʱرļ
+	/// @return дʧܷfalseûбʱɾļ
+	bool Close();
+
+	/////////////////////////////////////////////////////////////////
+	/// ͨļתΪֿļ
+	/// @para is_resume ȣϴжϵĽʱжϴ㷨ȲԽļΪ׼
+	/// @return ɹtrueʧʱɾļȱļͽļ
+	static bool EncryptFile(std::string in_filename, std::string out_filename,
+		XSecType type, std::string pass, int chunk_size = XSEEK_CHUNK_SIZE, XCodec codec = XCODEC_NONE,
+		bool is_resume = false);
+
+	/////////////////////////////////////////////////////////////////
+	/// ѷֿļԭΪͨļܺͽѹͬһ鴦
+	/// @return ɹtrueʧɾļ
+	static bool DecryptFile(std::string in_filename, std::string out_filename, std::string pass);
+
+	/////////////////////////////////////////////////////////////////
+	/// ѷֿļýշԿ¼ܣʽsinkĻʱļ
+	/// ÿβнbatchֿڴֻռbatchֿ飬ļС޹
+	/// ķֿСѹ㷨ͬѹķֿѹѹ
+	/// @para in_filename ֿļ
+	/// @para pass ļԿ
+	/// @para out_type շļ㷨
+	/// @para out_pass շԿ
+	/// @para sink 
+	/// @para batch ÿδķֿСڵ0̳߳߳
+	/// @return ɹtruesinkfalseʱֹͣfalse
+	static bool Transcode(std::string in_filename, std::string pass,
+		XSecType out_type, std::string out_pass, XSeekSink sink, int batch = 0);
+
+	/////////////////////////////////////////////////////////////////
+	/// ļܵsocketļдEINTR
+	/// WindowsSOCKETļsendԼʵXSeekSink
+	static XSeekSink FdSink(int fd);
+
+	/////////////////////////////////////////////////////////////////
+	/// ʱǷѹ㷨Ŀ
+	static bool IsCodecSupported(XCodec codec);
+
+	//ĴС
+	long long size() { return size_; }
+
+	//ֿĴС
+	int chunk_size() { return chunk_size_; }
+
+	//ֿ
+	int chunk_count() { return (int)index_.size(); }
+
+	//㷨
+	XSecType type() { return type_; }
+
+	//ѹ㷨
+	XCodec codec() { return codec_; }
+
+	~XSeekFile();
+
+private:
+	//
+	struct Chunk
+	{
+		long long offset = 0;
+		int size = 0;
+		unsigned char iv[16] = { 0 };
+		unsigned char tag[XSEC_TAG_SIZE] = { 0 };
+	};
+
+	//һֿ鲢д
+	//@para is_last ļһ飬AEADģʽд븽֤
+	bool WriteChunk(const unsigned char* data, int size, bool is_last);
+
+	//һֿ飬ѹʱȽܵtmpٽѹout
+	//@para tmp ѹʱʹãchunk_size+XSEEK_PAD_MAX+1ֽ
+	//@return ֽʧܷ-1
+	int DecryptChunk(XSec& sec, int index, const unsigned char* in, unsigned char* out, unsigned char* tmp);
+
+	//ļͷ
+	//@para size дļͷĴС
+	void MakeHead(unsigned char* head, long long size);
+
+	//ļͷʧܷfalse
+	bool ParseHead(const unsigned char* head);
+
+	//дõĻ
+	bool InitWrite();
+
+	//дļsink
+	bool Output(const unsigned char* data, long long size);
+
+	//ԿУֵļб棬ָʱȽ
+	bool KeyCheck(unsigned char* check);
+
+	//ļдļͷ
+	bool CreateCheckpoint();
+
+	//ļ̺ͬ󣬰дֿ׷ӵļͬ
+	bool Checkpoint();
+
+	XSec sec_;
+	XSecType type_ = XAES128_GCM;
+	std::string pass_;
+	bool is_aead_ = false;
+	XCodec codec_ = XCODEC_NONE;
+	bool is_write_ = false;
+	int chunk_size_ = XSEEK_CHUNK_SIZE;
+	long long size_ = 0;
+	unsigned char salt_[8] = { 0 };
+
+	std::vector<Chunk> index_;
+
+	//дʱδһ
+	std::vector<unsigned char> buf_;
+	int buf_size_ = 0;
+
+	//
+	std::vector<unsigned char> out_;
+
+	//ѹ
+	std::vector<unsigned char> zbuf_;
+
+	//zstdѹģڷֿ临
+	void* zctx_ = nullptr;
+	long long pos_ = 0;
+
+	std::string filename_;
+
+	//ȵļ0
+	long long ckpt_interval_ = 0;
+
+	//ѱ浽ļķֿ
+	int ckpt_count_ = 0;
+
+	//ϴαʱĴС
+	long long ckpt_size_ = 0;
+
+	//ļСEncryptFileָʱȷļûб
+	long long src_size_ = 0;
+	std::ofstream ofs_;
+	std::ifstream ifs_;
+
+	//ʽΪʱofs_
+	XSeekSink sink_;
+
+	//ʽʱļͷеĴС
+	long long sink_size_ = 0;
+};
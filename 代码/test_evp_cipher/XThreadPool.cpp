@@ -0,0 +1,132 @@
+#include "XThreadPool.h"
+using namespace std;
+
+/////////////////////////////////////////////////////////////////
+/// ȫ̳߳أһεʱCPU
+XThreadPool* XThreadPool::Instance()
+{
+	static XThreadPool pool;
+	static once_flag flag;
+	call_once(flag, [] { pool.Start(); });
+	return &pool;
+}
+
+/////////////////////////////////////////////////////////////////
+/// ߳
+/// @para thread_count ߳Сڵ0ȡCPU
+void XThreadPool::Start(int thread_count)
+{
+	Stop();
+	if (thread_count <= 0)
+		thread_count = thread::hardware_concurrency();
+	if (thread_count <= 0)
+		thread_count = 1;
+	is_exit_ = false;
+	for (int i = 0; i < thread_count; i++)
+	{
+		threads_.push_back(thread(&XThreadPool::Work, this));
+	}
+}
+
+/////////////////////////////////////////////////////////////////
+/// ֹͣй߳
+void XThreadPool::Stop()
+{
+	{
+		unique_lock<mutex> lock(mux_);
+		is_exit_ = true;
+	}
+	cv_.notify_all();
+	for (auto& th : threads_)
+	{
+		if (th.joinable())
+			th.join();
+	}
+	threads_.clear();
+}
+
+XThreadPool::~XThreadPool()
+{
+	Stop();
+}
+
+//ȡһִУΪշfalse
+bool XThreadPool::RunOne()
+{
+	function<void()> task;
+	{
+		unique_lock<mutex> lock(mux_);
+		if (tasks_.empty()) return false;
+		task = move(tasks_.front());
+		tasks_.pop_front();
+	}
+	task();
+	return true;
+}
+
+//߳
+void XThreadPool::Work()
+{
+	for (;;)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(mux_);
+			cv_.wait(lock, [this] { return is_exit_ || !tasks_.empty(); });
+			if (tasks_.empty()) return;
+			task = move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+	}
+}
+
+/////////////////////////////////////////////////////////////////
+/// ִһֱȫ
+/// ߳ҲִУڹ߳Ƕ׵ò
+/// @para tasks б
+void XThreadPool::Run(std::vector<std::function<void()> >& tasks)
+{
+	if (tasks.empty()) return;
+	if (tasks.size() == 1 || threads_.empty())
+	{
+		for (auto& t : tasks) t();
+		return;
+	}
+
+	//ʣδɵֻdone_mux¶д
+	//̳߳ʱһ֪̳ͨ߳ʱܿ0
+	//0󷵻ʱ߳Ѿٷ⼸ջϵĶ
+	int left = (int)tasks.size();
+	mutex done_mux;
+	condition_variable done_cv;
+	{
+		unique_lock<mutex> lock(mux_);
+		for (auto& t : tasks)
+		{
+			function<void()>* task = &t;
+			tasks_.push_back([task, &left, &done_mux, &done_cv] {
+				(*task)();
+				unique_lock<mutex> lock(done_mux);
+				if (--left == 0)
+					done_cv.notify_all();
+			});
+		}
+	}
+	cv_.notify_all();
+
+	//̰߳æִже
+	for (;;)
+	{
+		{
+			unique_lock<mutex> lock(done_mux);
+			if (left == 0)
+				return;
+		}
+		if (!RunOne())
+			break;
+	}
+
+	unique_lock<mutex> lock(done_mux);
+	done_cv.wait(lock, [&left] { return left == 0; });
+}
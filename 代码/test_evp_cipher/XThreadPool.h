@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+std::vector<std::function<void()> > tasks;
+tasks.push_back([&] { ... });
+XThreadPool::Instance()->Run(tasks);
+*/
+class XThreadPool
+{
+public:
+	/////////////////////////////////////////////////////////////////
+	/// ȫ̳߳أһεʱCPU
+	static XThreadPool* Instance();
+
+	/////////////////////////////////////////////////////////////////
+	/// ߳
+	/// @para thread_count ߳Сڵ0ȡCPU
+	void Start(int thread_count = 0);
+
+	/////////////////////////////////////////////////////////////////
+	/// ִһֱȫ
+	/// ߳ҲִУڹ߳Ƕ׵ò
+	/// @para tasks б
+	void Run(std::vector<std::function<void()> >& tasks);
+
+	/////////////////////////////////////////////////////////////////
+	/// ֹͣй߳
+	void Stop();
+
+	//߳
+	int thread_count() { return (int)threads_.size(); }
+
+	~XThreadPool();
+
+private:
+	//߳
+	void Work();
+
+	//ȡһִУΪշfalse
+	bool RunOne();
+
+	//߳
+	std::vector<std::thread> threads_;
+
+	//ִе
+	std::list<std::function<void()> > tasks_;
+
+	std::mutex mux_;
+	std::condition_variable cv_;
+	bool is_exit_ = false;
+};
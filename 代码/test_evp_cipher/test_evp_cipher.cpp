@@ -1,9 +1,20 @@
 #include <iostream>
 #include <openssl/evp.h>
 #include <openssl/err.h>
+#include <openssl/rand.h>
 #include <fstream>
 #include "XSec.h"
+#include "XCpu.h"
+#include "XBench.h"
+#include "XFileCrypt.h"
+#include "XFileService.h"
+#include "XFileMetrics.h"
+#include "XSeekFile.h"
+#include "XEnvelope.h"
 #include <ctime>
+#include <chrono>
+#include <vector>
+#include <mutex>
 
 using namespace std;
 
@@ -85,41 +96,72 @@ bool EncryptFile(string passwd, string in_filename, string out_filename,bool is_
 	return true;
 }
 
-bool XSecEncryptFile(string passwd, string in_filename, string out_filename, bool is_enc)
+//backend ļдʽˮߡڴӳio_uring
+bool XSecEncryptFile(string passwd, string in_filename, string out_filename, bool is_enc,
+	XFileBackend backend = XFILE_PIPELINE)
 {
-	ifstream ifs(in_filename, ios::binary);
-	if (!ifs) return false;
-	ofstream ofs(out_filename, ios::binary);
-	if (!ofs)
-	{
-		ifs.close();
+	//󻺳ˮߣļӽܡдļͬʱ
+	XFileCrypt fc;
+	if (!fc.Init(XAES128_CBC, passwd, is_enc))
 		return false;
-	}
-	XSec sec;
-	sec.Init(XAES128_CBC, passwd, is_enc);
+	bool re = fc.Encrypt(in_filename, out_filename, backend);
+	XFileStat st = fc.stat();
+	cout << "in_file_size:" << st.in_size << endl;
+	cout << "out_file_size:" << st.out_size << endl;
+	//ӽܡдĸӽʱ䣬ĸƿ
+	cout << "read:" << st.read_ms << "ms cipher:" << st.cipher_ms << "ms write:" << st.write_ms << "ms" << endl;
+	cout << "ʱ:" << st.total_ms / 1000 << " " << st.mbps << "MB/s" << endl;
+	return re;
+}
 
-	unsigned char buf[1024] = { 0 };
-	unsigned char out[1024] = { 0 };
-	int out_len = 0;
-	//ļ => ӽļ => дļ
-	while (!ifs.eof())
+//ļͬʱӽܣļΪļ.enc.dec
+bool XSecEncryptFiles(string passwd, vector<string> in_filenames, bool is_enc)
+{
+	XFileService fs;
+	mutex mux;
+	bool is_ok = true;
+
+	//ÿһJSONĻۼָдPrometheusıļ
+	XFileMetrics metrics;
+	metrics.SetJSONLog(&cout);
+	fs.SetCallback(metrics.Callback([&](const XFileJob&, const XFileJobResult& re) {
+		unique_lock<mutex> lock(mux);
+		if (!re.is_ok) is_ok = false;
+	}));
+	fs.Start();
+	auto start = chrono::steady_clock::now();
+	for (auto& in_filename : in_filenames)
 	{
-		//1ļ
-		ifs.read((char*)buf, sizeof(buf));
-		int count = ifs.gcount();
-		if (count <= 0) break;
-		bool is_end = false;
-		if (ifs.eof())
-			is_end = true;
-		out_len = sec.Encrypt(buf, count, out, is_end);
-		if (out_len <= 0)
-			break;
-		ofs.write((char*)out, out_len);
+		XFileJob job;
+		job.pass = passwd;
+		job.is_en = is_enc;
+		job.in_filename = in_filename;
+		job.out_filename = in_filename + (is_enc ? ".enc" : ".dec");
+		fs.Add(job);
 	}
-	
-	sec.close();
-	ifs.close();
-	ofs.close();
+	fs.Wait();
+	auto end = chrono::steady_clock::now();
+	metrics.WritePrometheus("xfile.prom");
+	cout << "ʱ:" << chrono::duration<double>(end - start).count() << "" << endl;
+	return is_ok;
+}
+
+//ȡֿļеһ
+bool XSeekRead(string passwd, string filename, long long pos, int size)
+{
+	XSeekFile sf;
+	if (!sf.Open(filename, passwd))
+		return false;
+	vector<unsigned char> buf(size);
+	auto start = chrono::steady_clock::now();
+	long long len = sf.Read(pos, buf.data(), size);
+	auto end = chrono::steady_clock::now();
+	if (len < 0)
+		return false;
+	cout << "file_size:" << sf.size() << " chunk_count:" << sf.chunk_count() << endl;
+	cout.write((char*)buf.data(), len);
+	cout << endl;
+	cout << "ʱ:" << chrono::duration<double>(end - start).count() << "" << endl;
 	return true;
 }
 
@@ -162,20 +204,124 @@ public:
 		cout << "================" << type_name << endl;
 		XSec sec;
 
+		//CTRAEADģʽnonceüʱiv
+		unsigned char iv[16] = { 0 };
+		RAND_bytes(iv, sizeof(iv));
+
 		//
-		sec.Init(type, passwd, true);
-		auto start = clock();
+		sec.Init(type, passwd, true, iv);
+		auto start = chrono::steady_clock::now();
 		int en_size = sec.Encrypt(in_, data_size_, en_);
-		auto end = clock();
-		cout <<en_size << "ܻʱ:" << (double)((end - start) / (double)CLOCKS_PER_SEC) << "" << endl;
+		auto end = chrono::steady_clock::now();
+		cout << en_size << "ܻʱ:" << chrono::duration<double>(end - start).count() << "" << endl;
+
+		//AEADģʽҪʱɵıǩ
+		unsigned char tag[XSEC_TAG_SIZE] = { 0 };
+		bool has_tag = sec.GetTag(tag);
 
 		//
-		sec.Init(type, passwd, false);
-		start = clock();
+		sec.Init(type, passwd, false, iv);
+		if (has_tag)
+			sec.SetTag(tag);
+		start = chrono::steady_clock::now();
 		int de_size = sec.Encrypt(en_, en_size, de_);
-		end = clock();
-		cout << en_size << "ܻʱ:" << (double)((end - start) / (double)CLOCKS_PER_SEC) << "" << endl;
+		end = chrono::steady_clock::now();
+		cout << de_size << "ܻʱ:" << chrono::duration<double>(end - start).count() << "" << endl;
+
+	}
+
+	//̷ֿ߳ӽܣͳǽʱ
+	void TestParallel(XSecType type, string type_name)
+	{
+		memset(en_, 0, data_size_ + 128);
+		memset(de_, 0, data_size_ + 128);
+		cout << "================" << type_name << " " << endl;
+		XSec sec;
+		unsigned char iv[16] = { 0 };
+		RAND_bytes(iv, sizeof(iv));
+
+		//
+		sec.Init(type, passwd, true, iv);
+		auto start = chrono::steady_clock::now();
+		int en_size = sec.ParallelEncrypt(in_, data_size_, en_);
+		auto end = chrono::steady_clock::now();
+		cout << en_size << "ܻʱ:" << chrono::duration<double>(end - start).count() << "" << endl;
+
+		//
+		sec.Init(type, passwd, false, iv);
+		start = chrono::steady_clock::now();
+		int de_size = sec.ParallelEncrypt(en_, en_size, de_);
+		end = chrono::steady_clock::now();
+		cout << de_size << "ܻʱ:" << chrono::duration<double>(end - start).count() << "" << endl;
+
+		if (de_size != data_size_ || memcmp(in_, de_, data_size_) != 0)
+			cout << "ԭݲһ!" << endl;
+	}
+
+	//С¼ÿrecord_sizeֽڣͳÿ봦ļ¼
+	void TestBatch(XSecType type, string type_name, int record_size = 16)
+	{
+		int count = data_size_ / (record_size + 128);
+		if (count <= 0) return;
+		cout << "================" << type_name << " " << endl;
+		vector<XSecRecord> records(count);
+
+		//CTRAEADģʽÿ¼Ҫвͬivü¼
+		vector<unsigned char> ivs((size_t)count * 16);
+		for (int i = 0; i < count; i++)
+		{
+			memcpy(ivs.data() + (size_t)i * 16, &i, sizeof(i));
+			records[i].in = in_ + i * record_size;
+			records[i].in_size = record_size;
+			records[i].out = en_ + i * (record_size + 128);
+			records[i].iv = ivs.data() + (size_t)i * 16;
+		}
+		XSec sec;
+		sec.Init(type, passwd, true);
+		auto start = chrono::steady_clock::now();
+		int ok = sec.EncryptBatch(records.data(), count);
+		auto end = chrono::steady_clock::now();
+		double sec_time = chrono::duration<double>(end - start).count();
+		cout << ok << "¼ܻʱ:" << sec_time << " " << (sec_time > 0 ? ok / sec_time : 0) << "/" << endl;
+	}
 
+	//̼߳ӽٶȣGB/sǰOpenSSLѡʵ
+	void TestSpeed(XSecType type, string type_name)
+	{
+		XSec sec;
+		unsigned char iv[16] = { 0 };
+		RAND_bytes(iv, sizeof(iv));
+		if (!sec.Init(type, passwd, true, iv))
+		{
+			cout << type_name << " ֧" << endl;
+			return;
+		}
+		//һԤȻCPUƵʣʽʱһnonce
+		int en_size = sec.Encrypt(in_, data_size_, en_);
+		RAND_bytes(iv, sizeof(iv));
+		sec.Init(type, passwd, true, iv);
+		auto start = chrono::steady_clock::now();
+		en_size = sec.Encrypt(in_, data_size_, en_);
+		auto end = chrono::steady_clock::now();
+		double en_time = chrono::duration<double>(end - start).count();
+
+		unsigned char tag[XSEC_TAG_SIZE] = { 0 };
+		bool has_tag = sec.GetTag(tag);
+		sec.Init(type, passwd, false, iv);
+		if (has_tag)
+			sec.SetTag(tag);
+		start = chrono::steady_clock::now();
+		int de_size = sec.Encrypt(en_, en_size, de_);
+		end = chrono::steady_clock::now();
+		double de_time = chrono::duration<double>(end - start).count();
+
+		double gb = data_size_ / 1e9;
+		cout << type_name << "\t" << XCpu::ImplName(type)
+			<< "\t " << (en_time > 0 ? gb / en_time : 0) << " GB/s"
+			<< "\t " << (de_time > 0 ? gb / de_time : 0) << " GB/s";
+		if (de_size != data_size_ || memcmp(in_, de_, data_size_) != 0)
+			cout << "\tԭݲһ!";
+		cout << endl;
 	}
 
 	~TestCipher()
@@ -202,9 +348,75 @@ private:
 
 //ci.Test(XDES_ECB, "XDES_ECB");
 #define TEST_CIPHER(s) ci.Test(s, #s);
+#define TEST_PARALLEL(s) ci.TestParallel(s, #s);
+#define TEST_BATCH(s) ci.TestBatch(s, #s);
+#define TEST_SPEED(s) ci.TestSpeed(s, #s);
 
 int main(int argc, char* argv[]) 
 {
+	//test_evp_cipher bench [csv|json] [ļ] [ݴС]
+	//ȫ㷨ݴС߳ܲԣָļĻ
+	if (argc > 1 && strcmp(argv[1], "bench") == 0)
+	{
+		string format = argc > 2 ? argv[2] : "csv";
+		XBenchConfig conf;
+		if (argc > 4)
+		{
+			long long max_size = atoll(argv[4]);
+			vector<int> sizes;
+			for (auto s : conf.sizes)
+				if (s <= max_size) sizes.push_back(s);
+			conf.sizes = sizes;
+		}
+		XBench bench;
+		bench.Init(conf);
+		auto re = bench.Run(argc > 3 ? &cout : nullptr);
+		string out = format == "json" ? XBench::ToJSON(re) : XBench::ToCSV(re);
+		if (argc > 3)
+		{
+			ofstream ofs(argv[3], ios::binary);
+			ofs << out;
+		}
+		else
+		{
+			cout << out;
+		}
+		return 0;
+	}
+
+	//test_evp_cipher cpu	ǰʵ¸㷨ٶ
+	//test_evp_cipher cpuall	ÿʵһӽ̲٣ԱȲͬʵ
+	if (argc > 1 && strcmp(argv[1], "cpuall") == 0)
+	{
+		for (int i = 0; i < XIMPL_COUNT; i++)
+		{
+			//OpenSSLʱȡOPENSSL_ia32capֻӽЧ
+			XCpu::SetImpl((XCpuImpl)i);
+			string cmd = string("\"") + argv[0] + "\" cpu";
+			system(cmd.c_str());
+		}
+		XCpu::SetImpl(XIMPL_AUTO);
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "cpu") == 0)
+	{
+		XCpu::Print();
+		TestCipher ci;
+		ci.Init(1024 * 1024 * 64);
+		TEST_SPEED(X3DES_CBC);
+		TEST_SPEED(XAES128_ECB);
+		TEST_SPEED(XAES128_CBC);
+		TEST_SPEED(XAES256_CBC);
+		TEST_SPEED(XAES128_CTR);
+		TEST_SPEED(XAES256_CTR);
+		TEST_SPEED(XAES128_GCM);
+		TEST_SPEED(XAES256_GCM);
+		TEST_SPEED(XSM4_CBC);
+		TEST_SPEED(XSM4_CTR);
+		TEST_SPEED(XCHACHA20_POLY1305);
+		return 0;
+	}
+
 	TestCipher ci;
 	ci.Init(1024 * 1024 * 100);//10MB
 	/*
@@ -219,7 +431,16 @@ int main(int argc, char* argv[])
 	XAES256_ECB,
 	XAES256_CBC,
 	XSM4_ECB,
-	XSM4_CBC
+	XSM4_CBC,
+	XAES128_CTR,
+	XAES192_CTR,
+	XAES256_CTR,
+	XSM4_CTR,
+	XAES128_GCM,
+	XAES192_GCM,
+	XAES256_GCM,
+	XSM4_GCM,
+	XCHACHA20_POLY1305
 	*/
 
 	/*TEST_CIPHER(XDES_ECB);
@@ -233,7 +454,39 @@ int main(int argc, char* argv[])
 	TEST_CIPHER(XAES256_ECB);
 	TEST_CIPHER(XAES256_CBC);
 	TEST_CIPHER(XSM4_ECB);
-	TEST_CIPHER(XSM4_CBC);*/
+	TEST_CIPHER(XSM4_CBC);
+	TEST_CIPHER(XAES128_CTR);
+	TEST_CIPHER(XSM4_CTR);
+	TEST_CIPHER(XAES128_GCM);
+	TEST_CIPHER(XAES256_GCM);
+	TEST_CIPHER(XSM4_GCM);
+	TEST_CIPHER(XCHACHA20_POLY1305);*/
+
+	//DES鴦EVP鴦Ա
+	/*XSec::SetEvpDes(false);
+	TEST_CIPHER(XDES_ECB);
+	TEST_CIPHER(XDES_CBC);
+	XSec::SetEvpDes(true);
+	TEST_CIPHER(XDES_ECB);
+	TEST_CIPHER(XDES_CBC);*/
+
+	/*TEST_PARALLEL(XDES_ECB);
+	TEST_PARALLEL(XAES128_ECB);
+	TEST_PARALLEL(XAES256_ECB);
+	TEST_PARALLEL(XSM4_ECB);
+	TEST_PARALLEL(XDES_CBC);
+	TEST_PARALLEL(X3DES_CBC);
+	TEST_PARALLEL(XAES128_CBC);
+	TEST_PARALLEL(XAES256_CBC);
+	TEST_PARALLEL(XSM4_CBC);
+	TEST_PARALLEL(XAES128_CTR);
+	TEST_PARALLEL(XAES256_CTR);
+	TEST_PARALLEL(XSM4_CTR);*/
+
+	/*TEST_BATCH(XAES128_ECB);
+	TEST_BATCH(XAES128_CBC);
+	TEST_BATCH(XAES128_CTR);
+	TEST_BATCH(XSM4_CTR);*/
 
 	//getchar();
 
@@ -242,6 +495,56 @@ int main(int argc, char* argv[])
 	XSecEncryptFile("1234567812345678", "DATA.txt", "data.encrypt.txt", true);
 	//ļ
 	XSecEncryptFile("1234567812345678", "data.encrypt.txt", "data.decrypt.txt", false);
+	//ڴӳӽļ
+	//XSecEncryptFile("1234567812345678", "DATA.txt", "data.encrypt.txt", true, XFILE_MAP);
+	//XSecEncryptFile("1234567812345678", "data.encrypt.txt", "data.decrypt.txt", false, XFILE_MAP);
+	//io_uring첽дӽļ
+	//XSecEncryptFile("1234567812345678", "DATA.txt", "data.encrypt.txt", true, XFILE_URING);
+	//XSecEncryptFile("1234567812345678", "data.encrypt.txt", "data.decrypt.txt", false, XFILE_URING);
+	//ļͬʱ
+	//XSecEncryptFiles("1234567812345678", { "DATA.txt", "data.decrypt.txt" }, true);
+	//ֿܣȡλ
+	//XSeekFile::EncryptFile("DATA.txt", "data.xscf", XAES128_GCM, "1234567812345678");
+	//XSeekRead("1234567812345678", "data.xscf", 100, 64);
+	//ѹٷֿܣʱͬʱѹ
+	//XSeekFile::EncryptFile("DATA.txt", "data.xscf", XAES128_GCM, "1234567812345678", XSEEK_CHUNK_SIZE, XCODEC_ZSTD);
+	//XSeekFile::DecryptFile("data.xscf", "data.decrypt.txt", "1234567812345678");
+	//ȣжϺٴεôжϴ
+	//XSeekFile::EncryptFile("DATA.txt", "data.xscf", XAES128_GCM, "1234567812345678", XSEEK_CHUNK_SIZE, XCODEC_NONE, true);
+	//ýշԿ¼ܣʽsocketܵļļ
+	//ofstream consumer_ofs("data.consumer.xscf", ios::binary);
+	//XSeekFile::Transcode("data.xscf", "1234567812345678", XAES128_GCM, "8765432187654321",
+	//	[&](const unsigned char* data, long long size) { return (bool)consumer_ofs.write((char*)data, size); });
+	//ŷ⣬ݶԳƼܣSM2ֻԿekдԼ
+	//ԿļֻһΣ֮ӻȡ
+	//ԿÿݶҪãԤȽԿ
+	//auto broker_pub = XEccKeyStore::Instance()->PublicKey("pubkey.pem", true);
+	//auto broker_pri = XEccKeyStore::Instance()->PrivateKey("private_pem");
+	//string ek;
+	//XEnvelope::SealFile(*broker_pub, "DATA.txt", "data.xscf", ek);
+	//XEnvelope::OpenFile(*broker_pri, ek, "data.xscf", "data.decrypt.txt");
+	//һֽߵekн
+	//vector<XEnvelopeKey> keys;
+	//XEnvelope::UnwrapKeys(*broker_pri, { ek }, keys);
+	//߶CID+ekǩ֤
+	//auto owner_pri = XEccKeyStore::Instance()->PrivateKey("owner_private_pem");
+	//auto owner_pub = XEccKeyStore::Instance()->PublicKey("owner_pubkey.pem");
+	//string manifest = string("QmCID") + ek;
+	//vector<unsigned char> sig;
+	//owner_pri->Sign((unsigned char*)manifest.data(), manifest.size(), sig);
+	//XEccVerifyItem item;
+	//item.key = owner_pub.get();
+	//item.data = (unsigned char*)manifest.data();
+	//item.size = manifest.size();
+	//item.sig = sig.data();
+	//item.sig_size = sig.size();
+	//XEccKey::VerifyBatch(&item, 1);
+	//̨ԤԿԣµֱȡãҪʱPEM
+	//XEccKeyPool key_pool;
+	//key_pool.Start();
+	//auto new_owner = key_pool.Get();
+	//new_owner->WritePEM("owner_pubkey.pem");
+	//new_owner->WritePEM("owner_private_pem", true);
 	getchar();
 
 	const unsigned char data[] = "12345678123456781";	//